@@ -14,73 +14,213 @@
 #define __W__Callback
 
 #include <iostream>
+#include <new>
+#include <cstring>
 
 #include "Event.h"
 
 namespace W {
-	
+
 	namespace EventPropagation {
 		enum T {
 			ShouldStop, ShouldContinue
 		};
 	}
 	
-	class CallbackBase {
-	public:
-		virtual ~CallbackBase() { }
-		virtual EventPropagation::T call(Event) { return W::EventPropagation::ShouldContinue; }
-		virtual CallbackBase* copy() = 0;
-	};
-	
-	
-	template <class T>
-	class MFCallback : public CallbackBase {
-		typedef EventPropagation::T (T::*mftype)(Event);
-	public:
-		MFCallback(mftype _f, T *_o) : f(_f), o(_o) { }
-		~MFCallback() { }
-		EventPropagation::T call(Event ev) {
-			return (o->*f)(ev);
-		}
-		CallbackBase* copy() {
-			return new MFCallback<T>(f, o);
-		}
-	protected:
-		mftype f;
-		T *o;
-	};
-	
+	// Callback is a delegate: it wraps a member function, free function or
+	// lambda, storing it inline - so creating & copying Callbacks never
+	// allocates.
+	//
+	// - resp identifies the responder, for unsubscription. For member
+	//   functions it is the object; otherwise, pass whatever you will later
+	//   pass to unsubscribe.
+	// - Lambdas must fit in Callback::StorageSize bytes: capture pointers,
+	//   not big objects.
 	
 	class Callback {
 	public:
+		enum { StorageSize = 4 * sizeof(void*) };
+		
+		Callback() : inv(NULL), mgr(NULL), resp(NULL) { }
+		
 		template <class T>
 		Callback(EventPropagation::T (T::*_f)(Event), T *_o) :
-			c(new MFCallback<T>(_f, _o)), resp(_o)
+			inv(&invokeMF<T, Event>), mgr(NULL), resp(_o)
 		{
 			// constr for event response callbacks
+			MF<T, Event> mf = { _f, _o };
+			store(mf);
+		}
+		template <class T>
+		Callback(EventPropagation::T (T::*_f)(const Event &), T *_o) :
+			inv(&invokeMF<T, const Event &>), mgr(NULL), resp(_o)
+		{
+			MF<T, const Event &> mf = { _f, _o };
+			store(mf);
+		}
+		
+		Callback(EventPropagation::T (*_f)(Event), void *_resp = NULL) :
+			inv(&invokeFn<Event>), mgr(NULL), resp(_resp)
+		{
+			store(_f);
+		}
+		Callback(EventPropagation::T (*_f)(const Event &), void *_resp = NULL) :
+			inv(&invokeFn<const Event &>), mgr(NULL), resp(_resp)
+		{
+			store(_f);
+		}
+		
+		template <class F>
+		Callback(const F &_f, void *_resp) :
+			inv(&invokeFunctor<F>), mgr(&manageFunctor<F>), resp(_resp)
+		{
+			static_assert(sizeof(F) <= StorageSize, "W::Callback: lambda captures too much to store inline");
+			new (st.bytes) F(_f);
+		}
+		
+		Callback(const Callback &c) :
+			inv(c.inv), mgr(c.mgr), resp(c.resp)
+		{
+			copyFrom(c);
+		}
+		Callback& operator= (const Callback &c) {
+			if (this != &c) {
+				destroy();
+				inv = c.inv, mgr = c.mgr, resp = c.resp;
+				copyFrom(c);
+			}
+			return *this;
 		}
 		~Callback()
 		{
-			delete c;
+			destroy();
+		}
+		
+		EventPropagation::T call(const Event &ev) {
+			return inv ? inv(st.bytes, ev) : EventPropagation::ShouldContinue;
+		}
+		bool isSet() const { return inv != NULL; }
+		void clear() { destroy(); inv = NULL, mgr = NULL, resp = NULL; }
+	
+	private:
+		typedef EventPropagation::T (*invoker)(void *, const Event &);
+		typedef void (*manager)(void *dst, const void *src);
+			// Copy-constructs src into dst, or destroys dst if src is NULL
+		
+		template <class T, class Arg>
+		struct MF {
+			EventPropagation::T (T::*f)(Arg);
+			T *o;
+		};
+		
+		template <class T, class Arg>
+		static EventPropagation::T invokeMF(void *p, const Event &ev) {
+			MF<T, Arg> &mf = *(MF<T, Arg>*) p;
+			return (mf.o->*mf.f)(ev);
 		}
-		EventPropagation::T call(Event ev) {
-			return c->call(ev);
+		template <class Arg>
+		static EventPropagation::T invokeFn(void *p, const Event &ev) {
+			return (*(EventPropagation::T (**)(Arg)) p)(ev);
 		}
-		Callback* copy() const {
-			return new Callback(c->copy(), resp);
+		template <class F>
+		static EventPropagation::T invokeFunctor(void *p, const Event &ev) {
+			return (*(F*) p)(ev);
 		}
+		template <class F>
+		static void manageFunctor(void *dst, const void *src) {
+			if (src) new (dst) F(*(const F*) src);
+			else ((F*) dst)->~F();
+		}
+		
+		template <class X>
+		void store(const X &x) {
+			static_assert(sizeof(X) <= StorageSize, "W::Callback: storage too small");
+			memcpy(st.bytes, &x, sizeof(X));
+		}
+		void copyFrom(const Callback &c) {
+			if (mgr) mgr(st.bytes, c.st.bytes);
+			else     memcpy(st.bytes, c.st.bytes, StorageSize);
+		}
+		void destroy() {
+			if (mgr) mgr(st.bytes, NULL);
+		}
+		
+		union {
+			unsigned char bytes[StorageSize];
+			void *_align_p;
+			double _align_d;
+		} st;
+		invoker inv;
+		manager mgr;
+	
+	public:
 		void *resp;
+	};
+	
+	
+	// BatchCallback is Callback's counterpart for batch subscriptions (see
+	// Messenger::subscribeToBatch): it receives all of a frame's events of one
+	// type in a single call.
+	// - Member functions & free functions only, so it is trivially copyable
+	
+	class BatchCallback {
+	public:
+		BatchCallback() : inv(NULL), resp(NULL) { }
 		
-	private:
-		Callback(CallbackBase *_c, void *_resp) :
-			c(_c), resp(_resp)
+		template <class T>
+		BatchCallback(void (T::*_f)(const Event *, int), T *_o) :
+			inv(&invokeMF<T>), resp(_o)
+		{
+			MF<T> mf = { _f, _o };
+			store(mf);
+		}
+		BatchCallback(void (*_f)(const Event *, int), void *_resp = NULL) :
+			inv(&invokeFn), resp(_resp)
 		{
-			// constr used by copy()
+			store(_f);
 		}
 		
-		CallbackBase *c;
+		void call(const Event *evs, int n) {
+			if (inv) inv(st.bytes, evs, n);
+		}
+		bool isSet() const { return inv != NULL; }
+		void clear() { inv = NULL, resp = NULL; }
+		
+	private:
+		typedef void (*invoker)(void *, const Event *, int);
+		
+		template <class T>
+		struct MF {
+			void (T::*f)(const Event *, int);
+			T *o;
+		};
+		
+		template <class T>
+		static void invokeMF(void *p, const Event *evs, int n) {
+			MF<T> &mf = *(MF<T>*) p;
+			(mf.o->*mf.f)(evs, n);
+		}
+		static void invokeFn(void *p, const Event *evs, int n) {
+			(*(void (**)(const Event *, int)) p)(evs, n);
+		}
+		
+		template <class X>
+		void store(const X &x) {
+			static_assert(sizeof(X) <= Callback::StorageSize, "W::BatchCallback: storage too small");
+			memcpy(st.bytes, &x, sizeof(X));
+		}
+		
+		union {
+			unsigned char bytes[Callback::StorageSize];
+			void *_align_p;
+			double _align_d;
+		} st;
+		invoker inv;
+		
+	public:
+		void *resp;
 	};
-	
+
 }
 
 #endif
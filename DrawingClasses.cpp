@@ -386,6 +386,30 @@ void W::Sprite::setBlendMode(BlendMode::T m) {
 }
 
 
+#pragma mark - SpriteBatch
+
+W::SpriteBatch::SpriteBatch(View *_v, Texture *_t, int _lay, BlendMode::T _blend)
+{
+	dSpriteBatch = new DSpriteBatch(_v, _t, instances, _lay, _blend);
+}
+W::SpriteBatch::~SpriteBatch()
+{
+	delete ((DSpriteBatch*) dSpriteBatch);
+}
+void W::SpriteBatch::update() {
+	((DSpriteBatch*) dSpriteBatch)->update(0, (int) instances.size());
+}
+void W::SpriteBatch::update(int from, int n) {
+	((DSpriteBatch*) dSpriteBatch)->update(from, n);
+}
+void W::SpriteBatch::setLayer(int l) {
+	((DSpriteBatch*) dSpriteBatch)->setLayer(l);
+}
+void W::SpriteBatch::setBlendMode(BlendMode::T m) {
+	((DSpriteBatch*) dSpriteBatch)->setBlendMode(m);
+}
+
+
 
 #pragma mark - DText
 
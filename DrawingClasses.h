@@ -18,6 +18,12 @@
 #include "View.h"
 #include "Texture.h"
 
+#include <vector>
+
+// Drawing objects are drawn in order of layer, lowest first. Within a
+// layer, the order is unspecified & may change as objects are removed:
+// to control how overlapping objects stack, give them different layers.
+
 namespace W {
 	
 	class Triangle {
@@ -202,6 +208,42 @@ namespace W {
 	};
 
 
+	// SpriteBatch draws many sprites sharing a texture as a single drawable.
+	// Each is a compact record rather than a drawable of its own: records
+	// are turned into vertices in bulk by update(), so it is feasible to
+	// draw very large numbers (100k+) of sprites.
+	
+	struct SpriteInstance {
+		SpriteInstance(v2f _pos = v2f(), v2f _scale = v2f(1,1), float _rotInDegrees = 0, float _opac = 1, iRect _frame = iRect()) :
+			pos(_pos), scale(_scale), rot(_rotInDegrees), opac(_opac), frame(_frame) { }
+		
+		v2f pos, scale;
+		float rot;
+		float opac;
+		iRect frame;	// Area of the texture to draw, in pixels. If of zero size, the whole texture
+	};
+	
+	class SpriteBatch {
+	public:
+		SpriteBatch(View *, Texture *, int layer = DEFAULT_LAYER, BlendMode::T = BlendMode::Normal);
+		~SpriteBatch();
+		
+		std::vector<SpriteInstance> instances;
+		
+		void update();					// Call after changing instances
+		void update(int from, int n);	// Call after changing only these, with the number of instances unchanged
+		
+		void setLayer(int);
+		void setBlendMode(BlendMode::T);
+	
+	private:
+		void *dSpriteBatch;
+		
+		SpriteBatch(const SpriteBatch &);				// dSpriteBatch refers to instances:
+		SpriteBatch& operator= (const SpriteBatch &);	// no copying
+	};
+
+
   class RetroText {
   public:
     RetroText(View *, v2f position, std::string txt, Colour, TextAlign::T = TextAlign::Left, int layer = DEFAULT_LAYER, BlendMode::T blendMode = BlendMode::Normal);
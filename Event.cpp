@@ -11,21 +11,37 @@
  */
 
 #include "Event.h"
+#include "EventQueue.h"
+#include "Log.h"
 #if defined WTARGET_MAC
 	#include <Cocoa/Cocoa.h>
 #endif
 
-W::EventType::T W::Event::_typecounter = 100;
-std::vector<W::Event> W::Event::_events;
-W::Mutex W::Event::_mutex;
+#include <map>
+#include <deque>
+#include <type_traits>
 
-W::Event::Event(EventType::T _type) : type(_type) { }
-W::Event::Event(EventType::T _type, v2i _pos) : type(_type), pos(_pos) { }
-W::Event::Event(EventType::T _type, KeyCode::T _key) : type(_type), key(_key) { }
-W::Event::Event(EventType::T _type, float _x) : type(_type), x(_x) { }
-W::Event::Event(EventType::T _type, int _touchID, v2i _pos, v2i _prev_pos) : type(_type), touchID(_touchID), pos(_pos), prev_pos(_prev_pos) { }
+static_assert(std::is_trivially_copyable<W::Event>::value, "W::Event must be trivially copyable");
 
-std::string W::Event::_printType() {
+std::atomic<int> W::Event::_typecounter(100);
+
+namespace {
+	W::EventQueue _queue;
+	std::atomic<int> _nDropped(0);	// Logged by the consumer, as producers may be on any thread
+}
+
+W::Event::Event(EventType::T _type) :
+	type(_type), key(KeyCode::K_OTHER), x(0), touchID(0), payload(NoPayload) { }
+W::Event::Event(EventType::T _type, v2i _pos) :
+	pos(_pos), type(_type), key(KeyCode::K_OTHER), x(0), touchID(0), payload(NoPayload) { }
+W::Event::Event(EventType::T _type, KeyCode::T _key) :
+	type(_type), key(_key), x(0), touchID(0), payload(NoPayload) { }
+W::Event::Event(EventType::T _type, float _x) :
+	type(_type), key(KeyCode::K_OTHER), x(_x), touchID(0), payload(NoPayload) { }
+W::Event::Event(EventType::T _type, int _touchID, v2i _pos, v2i _prev_pos) :
+	pos(_pos), prev_pos(_prev_pos), type(_type), key(KeyCode::K_OTHER), x(0), touchID(_touchID), payload(NoPayload) { }
+
+std::string W::Event::_printType() const {
 	using namespace EventType;
 	std::stringstream ss;
 	switch(type) {
@@ -52,6 +68,38 @@ std::string W::Event::_printType() {
 	return ss.str();
 }
 
+
+/*** Payload interning ***/
+
+namespace {
+	std::deque<std::string> _internedStrings;	// deque: references stay valid as it grows
+	std::map<std::string, int> _internedIDs;
+	W::Mutex *_internMutex = new W::Mutex();
+		// Interning is rare (e.g. when UI is loaded), so a lock is fine
+}
+
+int W::Event::internString(const std::string &str) {
+	_internMutex->lock();
+	int id;
+	std::map<std::string, int>::iterator it = _internedIDs.find(str);
+	if (it != _internedIDs.end())
+		id = it->second;
+	else {
+		id = (int) _internedStrings.size();
+		_internedStrings.push_back(str);
+		_internedIDs[str] = id;
+	}
+	_internMutex->unlock();
+	return id;
+}
+const std::string& W::Event::stringForID(int id) {
+	static const std::string empty;
+	_internMutex->lock();
+	const std::string &str = (id >= 0 && id < (int) _internedStrings.size() ? _internedStrings[id] : empty);
+	_internMutex->unlock();
+	return str;
+}
+
 W::EventType::T W::Event::registerType() {
 	return _typecounter++;
 }
@@ -72,14 +120,14 @@ W::KeyCode::T W::Event::charToKeycode(unsigned int c) {
 	#endif
 	return W::KeyCode::K_OTHER;
 }
-void W::Event::_addEvent(W::Event ev) {
-	#if defined(WTARGET_WIN)
-		_mutex.lock();
-	#endif
-	
-	Event::_events.push_back(ev);
-	
-	#if defined(WTARGET_WIN)
-		_mutex.unlock();
-	#endif
+bool W::Event::_addEvent(const W::Event &ev) {
+	if (_queue.push(ev))
+		return true;
+	++_nDropped;
+	return false;
+}
+int W::Event::_drainEvents(std::vector<Event> &out) {
+	if (int n = _nDropped.exchange(0))
+		W::log << "Event queue full: dropped " << n << " event(s)\n";
+	return _queue.drain(out);
 }
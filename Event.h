@@ -16,6 +16,8 @@
 #include "types.h"
 #include "Mutex.h"
 #include <string>
+#include <vector>
+#include <atomic>
 
 namespace W {
 	
@@ -67,6 +69,10 @@ namespace W {
 		};
 	}
 	
+	// Event is trivially copyable, so may be copied & queued freely without
+	// allocating. String payloads (e.g. button names) are interned: the
+	// payload is an integer ID, obtained from internString().
+	
 	class Event {
 	public:
 		Event(EventType::T);
@@ -75,7 +81,7 @@ namespace W {
 		Event(EventType::T, float _x);
 		Event(EventType::T, int _touchID, v2i _pos, v2i _prev_pos = v2i(-1,-1));
 		
-		std::string _printType();
+		std::string _printType() const;
 		
 		v2f pos;
 		v2f prev_pos;
@@ -83,21 +89,29 @@ namespace W {
 		KeyCode::T key;
 		float x;
 		int touchID;
-		std::string payload;
+		int payload;	// Interned string ID, or NoPayload
+		
+		void setPayload(const std::string &s) { payload = internString(s); }
+		const std::string& payloadString() const { return stringForID(payload); }
+		
+		enum { NoPayload = -1 };
+		static int internString(const std::string &);
+			// Returns a dense ID (0, 1, 2...) for the string, the same each time
+		static const std::string& stringForID(int);
+			// Returns "" for NoPayload
 		
 		static EventType::T registerType();
+			// Thread-safe
 		static KeyCode::T charToKeycode(unsigned int c);
 		
-		static std::vector<Event> _events;
-		static void _addEvent(Event);
-			// W's event queue
-		
-		static Mutex _mutex;
-			// On windows due to MMT usage the event harvesting
-			// code is on a sep. thread to the update cycle.
+		static bool _addEvent(const Event &);
+			// Add to W's event queue. Safe to call from any thread - e.g. to post
+			// registerType() events from a worker. Returns false if the queue is full.
+		static int _drainEvents(std::vector<Event> &);
+			// Update loop only: appends the events queued so far
 		
 	private:
-		static int _typecounter;
+		static std::atomic<int> _typecounter;
 	};
 	
 }
@@ -11,6 +11,7 @@
  */
 
 #include "W.h"
+#include "W_internal.h"
 
 
 #pragma mark - Gamestate
@@ -34,6 +35,9 @@ void W::GameState::addView(View *v) {
 	_vlist.push_back(v);
 }
 void W::GameState::removeView(View *v) {
+	// The render thread may still be drawing v: wait, so that the caller
+	// may then delete it
+	_waitForRenderThread();
 	_vlist.remove(v);
 }
 
@@ -37,6 +37,8 @@ namespace W {
 		
 		void addView(View *);
 		void removeView(View *);
+			// Remove a view before deleting it - this waits for the render
+			// thread to finish with it, before any subclass destructor runs
 		Viewlist _vlist;
 		
 		virtual void handleCloseEvent();	// By default, initiates the killer returny tango: override to customise
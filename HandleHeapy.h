@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am - :-)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * ABOUT HANDLEHEAPY
+ *
+ * HandleHeapy is MisterHeapy's less fussy sibling: a binary heap of pointers to objects which, like
+ * MisterHeapy, supports updating any object in O(logN) without knowing its index -- but which does
+ * NOT require the objects to be contiguous in memory.
+ *
+ * Instead of MisterHeapy's lookup table, each object stores its own position in the heap (an "intrusive"
+ * index). The pointer to the object is its handle: it remains valid for as long as the object does, no
+ * matter how the heap is reshuffled. So HandleHeapy is suitable for objects scattered about the place:
+ * timers, scheduled events, nodes belonging to several NavMaps, etc.
+ *
+ *     - push, pop, update & remove are O(logN)
+ *     - top & contains are O(1)
+ *
+ * ~~ Crafting Your Objects ~~
+ *
+ * As for MisterHeapy, your objects must implement:
+ *     1. `void setComparand(new_value)`
+ *     2. The operator `<`, taking a pointer to another object of the same class
+ *           (if A's comparand is "greater" than B's, A will be above B in the heap)
+ *
+ * In addition, they must implement:
+ *     3. `void setHeapIndex(int)` and `int heapIndex()`
+ *           These should store & return an int. HandleHeapy sets it to -1 when an object leaves the heap.
+ *           An object should be in only one HandleHeapy at a time. e.g. for a Timer:
+ *             `void setHeapIndex(int i) { heap_index = i; }`
+ *             `int heapIndex() { return heap_index; }`
+ *           Initialize the index to -1 in your constructor, so that `contains()` works before it is pushed.
+ *
+ * ~~ Creating Your HandleHeapy Instance ~~
+ *
+ *     `HandleHeapy<Timer*, double> timers;`
+ *     `HandleHeapy<Timer*, double> timers(256);`   // Reserve space for 256 objects up front
+ *
+ * Unlike MisterHeapy there is no maximum size: the heap grows as needed.
+ *
+ * ~~ Scheduling ~~
+ *
+ * For a scheduling queue, you'll want the soonest item at the top: have your `operator<` return true
+ * if the *other* object is due sooner (as NavNode does for distances). Then:
+ *
+ *     while (timers.size() && timers.top()->due <= now)
+ *         timers.pop()->fire();
+ *
+ * To reschedule, call `update(t, new_due)`. To cancel, call `remove(t)`.
+ *
+ */
+
+#ifndef HANDLEHEAPY_H
+#define HANDLEHEAPY_H
+
+#include <vector>
+
+template <class nodetype, typename comparandtype>
+class HandleHeapy {
+public:
+	typedef std::vector<nodetype> queue_type;
+
+	// Methods
+	HandleHeapy(int initial_capacity = 0);
+	void reset();				// Empties the heap, marking all objects as removed
+
+	void fast_push(nodetype x);	// Push onto the heap without sorting into place. Use to initialize, then call...
+	void reheapify();			// Set the heap back in order.
+
+	void push(nodetype);
+	nodetype pop();
+	nodetype top();				// The top object, without removing it
+	bool remove(nodetype x);	// Remove an arbitrary object. Returns false if it isn't in the heap.
+	int size();
+	bool contains(nodetype x);
+
+	void update(nodetype x, comparandtype new_val);		// Update a stored object to a new comparand value
+	void update_at(int i, comparandtype new_val);		// Update at a known location in the underlying array
+
+protected:
+	// Methods
+	void swap_nodes(int ind1, int ind2);
+	void up_heap(int _ind);
+	void down_heap(int _ind);
+	void resift(int _ind);
+
+	// Properties
+	queue_type heap;
+};
+
+
+/* Implementation */
+
+template <class nodetype, typename comparandtype>
+HandleHeapy<nodetype, comparandtype>::HandleHeapy(int initial_capacity) {
+	heap.reserve(initial_capacity);
+}
+
+template <class nodetype, typename comparandtype>
+void HandleHeapy<nodetype, comparandtype>::reset() {
+	for (typename queue_type::iterator it = heap.begin(); it != heap.end(); ++it)
+		(*it)->setHeapIndex(-1);
+	heap.clear();
+}
+
+template <class nodetype, typename comparandtype>
+void HandleHeapy<nodetype, comparandtype>::fast_push(nodetype x) {
+	x->setHeapIndex((int) heap.size());
+	heap.push_back(x);
+}
+
+template <class nodetype, typename comparandtype>
+void HandleHeapy<nodetype, comparandtype>::push(nodetype x) {
+	fast_push(x);
+	up_heap((int) heap.size() - 1);
+}
+
+template <class nodetype, typename comparandtype>
+nodetype HandleHeapy<nodetype, comparandtype>::pop() {
+	nodetype popsicle = heap[0];
+	remove(popsicle);
+	return popsicle;
+}
+
+template <class nodetype, typename comparandtype>
+nodetype HandleHeapy<nodetype, comparandtype>::top() {
+	return heap[0];
+}
+
+template <class nodetype, typename comparandtype>
+bool HandleHeapy<nodetype, comparandtype>::remove(nodetype x) {
+	if (!contains(x)) return false;
+	int i = x->heapIndex(), last = (int) heap.size() - 1;
+	swap_nodes(i, last);
+	heap.pop_back();
+	x->setHeapIndex(-1);
+
+	// The node moved into i came from the bottom, so may need to go either way
+	if (i < last) resift(i);
+	return true;
+}
+
+template <class nodetype, typename comparandtype>
+int HandleHeapy<nodetype, comparandtype>::size() {
+	return (int) heap.size();
+}
+
+template <class nodetype, typename comparandtype>
+bool HandleHeapy<nodetype, comparandtype>::contains(nodetype x) {
+	int i = x->heapIndex();
+	return i >= 0 && i < (int) heap.size() && heap[i] == x;
+}
+
+template <class nodetype, typename comparandtype>
+void HandleHeapy<nodetype, comparandtype>::swap_nodes(int ind1, int ind2) {
+	nodetype x1 = heap[ind1], x2 = heap[ind2];
+	heap[ind1] = x2;
+	x2->setHeapIndex(ind1);
+	heap[ind2] = x1;
+	x1->setHeapIndex(ind2);
+}
+
+template <class nodetype, typename comparandtype>
+void HandleHeapy<nodetype, comparandtype>::up_heap(int _ind) {
+	int ind = _ind, parent_ind = (ind-1)/2;
+
+	while (ind > 0 && *heap[parent_ind] < heap[ind]) {
+		swap_nodes(parent_ind, ind);
+		ind = parent_ind;
+		parent_ind = (ind-1)/2;
+	}
+}
+
+template <class nodetype, typename comparandtype>
+void HandleHeapy<nodetype, comparandtype>::down_heap(int _ind) {
+	int length = (int) heap.size();
+	int ind = _ind, l_child_ind = ind*2+1, r_child_ind = ind*2+2, larger_child_ind;
+	nodetype our_node = heap[ind];
+
+	while (l_child_ind < length) {
+		if (r_child_ind < length)
+			larger_child_ind = (*heap[l_child_ind] < heap[r_child_ind] ? r_child_ind : l_child_ind);
+		else
+			larger_child_ind = l_child_ind;
+		if (*our_node < heap[larger_child_ind]) {
+			swap_nodes(ind, larger_child_ind);
+			ind = larger_child_ind;
+			l_child_ind = ind*2+1, r_child_ind = ind*2+2;
+		}
+		else
+			break;
+	}
+}
+
+template <class nodetype, typename comparandtype>
+void HandleHeapy<nodetype, comparandtype>::resift(int i) {
+	int parent_i = (i-1)/2;
+	if (i == 0 || *heap[i] < heap[parent_i])
+		down_heap(i);
+	else
+		up_heap(i);
+}
+
+template <class nodetype, typename comparandtype>
+void HandleHeapy<nodetype, comparandtype>::reheapify() {
+	// Floyd's method: down_heap every non-leaf node, from the last upwards
+	for (int i = (int) heap.size()/2 - 1; i >= 0; --i)
+		down_heap(i);
+}
+
+template <class nodetype, typename comparandtype>
+void HandleHeapy<nodetype, comparandtype>::update_at(int i, comparandtype new_val) {
+	if (i < 0 || i >= (int) heap.size()) return;
+	heap[i]->setComparand(new_val);
+	resift(i);
+}
+
+template <class nodetype, typename comparandtype>
+void HandleHeapy<nodetype, comparandtype>::update(nodetype x, comparandtype new_val) {
+	if (!contains(x)) return;
+	update_at(x->heapIndex(), new_val);
+}
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ============
+ *  Jobs.cpp
+ * ============
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+#include "Jobs.h"
+#include "Log.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+	
+	// A thread's queue of jobs: its own thread pushes & pops at the back,
+	// others steal from the front. A ring buffer, grown as needed.
+	struct JobQueue {
+		JobQueue() : buf(64), head(0), n(0) { }
+		
+		void pushBack(const W::Job &j) {
+			if (n == (int) buf.size()) grow();
+			buf[(head + n) & mask()] = j;
+			++n;
+		}
+		bool popBack(W::Job &j) {
+			if (!n) return false;
+			--n;
+			j = buf[(head + n) & mask()];
+			return true;
+		}
+		bool popFront(W::Job &j) {
+			if (!n) return false;
+			j = buf[head];
+			head = (head + 1) & mask();
+			--n;
+			return true;
+		}
+		
+		std::mutex mutex;
+	
+	private:
+		int mask() { return (int) buf.size() - 1; }
+		void grow() {
+			std::vector<W::Job> b(buf.size() * 2);
+			for (int i=0; i < n; ++i)
+				b[i] = buf[(head + i) & mask()];
+			buf.swap(b);
+			head = 0;
+		}
+		
+		std::vector<W::Job> buf;	// Size is a power of 2
+		int head, n;
+	};
+	
+	struct Pool {
+		Pool() : nQueued(0), quit(false) { }
+		
+		// queues[0] is shared by all threads outside the pool; worker i has queues[i]
+		std::vector<JobQueue*> queues;
+		std::vector<std::thread> threads;
+		
+		std::atomic<int> nQueued;
+		std::atomic<bool> quit;
+		std::mutex sleepMutex;
+		std::condition_variable wake;
+	};
+	
+	Pool pool;
+	std::mutex poolMutex;		// Guards starting & stopping the pool
+	std::atomic<int> nThreads(-1);	// -1: not yet started
+	thread_local int myQueue = 0;
+	thread_local int jobDepth = 0;	// Jobs running on this thread, including nested ones
+	
+	W::TaskGroup frameGroup;
+	
+	bool runOne() {
+		int nq = (int) pool.queues.size();
+		if (!nq || pool.nQueued.load(std::memory_order_acquire) == 0)
+			return false;
+		
+		W::Job j;
+		bool got = false;
+		
+		// Our own queue first, newest job first; then steal others' oldest
+		{
+			JobQueue &q = *pool.queues[myQueue];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			got = q.popBack(j);
+		}
+		for (int i=1; i < nq && !got; ++i) {
+			JobQueue &q = *pool.queues[(myQueue + i) % nq];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			got = q.popFront(j);
+		}
+		if (!got)
+			return false;
+		
+		pool.nQueued.fetch_sub(1, std::memory_order_relaxed);
+		++jobDepth;
+		j.run();
+		--jobDepth;
+		if (j.group) j.group->_jobDone();
+		return true;
+	}
+	
+	void workerMain(int index) {
+		myQueue = index;
+		while (!pool.quit.load()) {
+			if (runOne())
+				continue;
+			std::unique_lock<std::mutex> lock(pool.sleepMutex);
+			pool.wake.wait(lock, []() { return pool.quit.load() || pool.nQueued.load() > 0; });
+		}
+	}
+	
+	void stopPool(bool drain) {
+		{
+			std::lock_guard<std::mutex> lock(pool.sleepMutex);
+			pool.quit = true;
+		}
+		pool.wake.notify_all();
+		for (std::vector<std::thread>::iterator it = pool.threads.begin(); it < pool.threads.end(); ++it)
+			it->join();
+		pool.threads.clear();
+		
+		// Run what the workers left - or discard it, still notifying each job's
+		// group, so that none is left waiting on a job that will never run
+		if (drain)
+			while (runOne()) ;
+		W::Job j;
+		for (std::vector<JobQueue*>::iterator it = pool.queues.begin(); it < pool.queues.end(); ++it)
+			while ((*it)->popFront(j)) {
+				pool.nQueued.fetch_sub(1, std::memory_order_relaxed);
+				if (j.group) j.group->_jobDone();
+			}
+		for (std::vector<JobQueue*>::iterator it = pool.queues.begin(); it < pool.queues.end(); ++it)
+			delete *it;
+		pool.queues.clear();
+		pool.quit = false;
+	}
+	
+	void startPool(int n) {
+		for (int i=0; i <= n; ++i)
+			pool.queues.push_back(new JobQueue());
+		for (int i=1; i <= n; ++i)
+			pool.threads.push_back(std::thread(workerMain, i));
+		nThreads = n;
+	}
+	
+	struct PoolStopper {
+		~PoolStopper() {
+			if (nThreads > 0) stopPool(false);
+		}
+	} poolStopper;
+	
+}
+
+void W::Jobs::setThreadCount(int n) {
+	if (jobDepth > 0) {
+		W::log << "Jobs::setThreadCount() called from a job: ignoring\n";
+		return;
+	}
+	std::lock_guard<std::mutex> lock(poolMutex);
+	if (n < 0) n = 0;
+	if (nThreads >= 0) {
+		// Join the workers, then run what they left, so no group is left waiting
+		// on a job destroyed with the queues
+		stopPool(true);
+	}
+	startPool(n);
+}
+int W::Jobs::threadCount() {
+	int n = nThreads.load(std::memory_order_acquire);
+	if (n >= 0)
+		return n;
+	
+	// Start the pool on first use: one worker per core, besides this thread
+	std::lock_guard<std::mutex> lock(poolMutex);
+	if (nThreads < 0) {
+		int cores = (int) std::thread::hardware_concurrency();
+		startPool(cores > 1 ? cores - 1 : 0);
+	}
+	return nThreads;
+}
+
+void W::Jobs::_push(const Job &j) {
+	JobQueue &q = *pool.queues[myQueue];
+	{
+		std::lock_guard<std::mutex> lock(q.mutex);
+		q.pushBack(j);
+	}
+	pool.nQueued.fetch_add(1, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(pool.sleepMutex);
+	}
+	pool.wake.notify_one();
+}
+bool W::Jobs::_runOne() {
+	return runOne();
+}
+
+W::TaskGroup& W::Jobs::_frameGroup() {
+	return frameGroup;
+}
+void W::Jobs::_joinFrameJobs() {
+	frameGroup.wait();
+}
+
+void W::TaskGroup::wait() {
+	while (pending.load(std::memory_order_acquire) > 0)
+		if (!runOne())
+			std::this_thread::yield();
+}
@@ -0,0 +1,144 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ==========
+ *  Jobs.h
+ * ==========
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+// The job system runs work on a pool of threads, one per core.
+// - Each thread has its own queue of jobs: it takes from the back of its
+//   own, and when that is empty steals from the front of the others'.
+// - TaskGroup runs a set of jobs & waits for them. While waiting, the
+//   waiting thread runs jobs too, so groups may be nested.
+// - parallel_for() splits a range of indices into jobs.
+// - Jobs::submit() runs a job alongside the current update: W waits for all
+//   such jobs after GameState::update(), before drawing.
+//
+// Jobs are stored inline, like Callbacks, so submitting a job never
+// allocates: a job must be a function object no bigger than
+// Job::StorageSize, that can be copied with memcpy - a lambda capturing
+// pointers, references & numbers. Jobs should not throw.
+
+#ifndef __W__Jobs
+#define __W__Jobs
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+namespace W {
+	
+	class TaskGroup;
+	
+	class Job {
+	public:
+		enum { StorageSize = 4 * sizeof(void*) };
+		
+		Job() : group(NULL), inv(NULL) { }
+		
+		template <class F>
+		Job(const F &f, TaskGroup *_group) : group(_group), inv(&invoke<F>) {
+			static_assert(sizeof(F) <= StorageSize, "W::Job: job captures too much to store inline");
+			static_assert(std::is_trivially_copyable<F>::value, "W::Job: job must be trivially copyable");
+			memcpy(st.bytes, &f, sizeof(F));
+		}
+		
+		void run() { inv(st.bytes); }
+		
+		TaskGroup *group;	// Notified when the job has run, if not NULL
+	
+	private:
+		typedef void (*invoker)(void *);
+		
+		template <class F>
+		static void invoke(void *p) { (*(F*) p)(); }
+		
+		union {
+			unsigned char bytes[StorageSize];
+			void *_align_p;
+			double _align_d;
+		} st;
+		invoker inv;
+	};
+	
+	namespace Jobs {
+		void _push(const Job &);
+		bool _runOne();	// Run a queued job, if there is one
+		
+		void setThreadCount(int);	// Workers, in addition to the calling thread. 0: run everything inline.
+			// Jobs still queued are run on the calling thread before resizing.
+			// Must not be called from a job: if so, it is ignored.
+		int threadCount();
+		
+		TaskGroup& _frameGroup();
+		void _joinFrameJobs();
+		
+		template <class F>
+		void submit(const F &f);
+	}
+	
+	class TaskGroup {
+	public:
+		TaskGroup() : pending(0) { }
+		~TaskGroup() { wait(); }
+		
+		template <class F>
+		void run(const F &f) {
+			if (Jobs::threadCount() == 0) {
+				f();
+				return;
+			}
+			pending.fetch_add(1, std::memory_order_relaxed);
+			Jobs::_push(Job(f, this));
+		}
+		void wait();
+		
+		void _jobDone() { pending.fetch_sub(1, std::memory_order_release); }
+	
+	private:
+		TaskGroup(const TaskGroup &);
+		TaskGroup& operator= (const TaskGroup &);
+		
+		std::atomic<int> pending;
+	};
+	
+	template <class F>
+	void Jobs::submit(const F &f) {
+		_frameGroup().run(f);
+	}
+	
+	// Calls f(i) for each i in [begin, end), in parallel, returning once all
+	// have run. Each job takes grainSize indices: by default, enough for
+	// ~4 jobs per thread.
+	template <class F>
+	void parallel_for(int begin, int end, const F &f, int grainSize = 0) {
+		int n = end - begin;
+		if (n <= 0) return;
+		if (grainSize <= 0) {
+			grainSize = n / (4 * (Jobs::threadCount() + 1));
+			if (grainSize < 1) grainSize = 1;
+		}
+		if (grainSize >= n || Jobs::threadCount() == 0) {
+			for (int i = begin; i < end; ++i) f(i);
+			return;
+		}
+		
+		const F *fp = &f;
+		TaskGroup g;
+		for (int from = begin; from < end; from += grainSize) {
+			int to = (end - from > grainSize ? from + grainSize : end);
+			g.run([fp, from, to]() {
+				for (int i = from; i < to; ++i) (*fp)(i);
+			});
+		}
+		g.wait();
+	}
+	
+}
+
+#endif
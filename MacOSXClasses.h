@@ -36,7 +36,7 @@ typedef void (*vdfncb)(void);
 
 @interface W_UpdateTimer : NSObject
 -(id)initWithCallback:(vdfncb)fp;
--(void)start;
+-(void)startWithFrequency:(int)hz;	// 0: default (40Hz)
 -(void)stop;
 -(void)callback:(NSTimer*)_t;
 @end
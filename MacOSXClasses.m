@@ -223,8 +223,8 @@
 	return self;
 }
 
--(void)start {
-	t = [NSTimer scheduledTimerWithTimeInterval:1./40.
+-(void)startWithFrequency:(int)hz {
+	t = [NSTimer scheduledTimerWithTimeInterval:(hz ? 1./hz : 1./40.)
 										 target:self
 									   selector:@selector(callback:)
 									   userInfo:nil
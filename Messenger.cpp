@@ -14,7 +14,10 @@
 #include "Callback.h"
 #include "View.h"
 #include "GameState.h"
+#include "RectIndex.h"
+#include "Profiler.h"
 #include <iostream>
+#include <unordered_map>
 
 using std::map;
 using std::vector;
@@ -22,20 +25,26 @@ using std::string;
 
 #pragma mark MState
 
-struct cbAndRect {
-	W::Callback *cb;
-	W::fRect *rct;
-	cbAndRect(W::Callback *_cb, W::fRect *_rct) { cb = _cb; rct = _rct; }
-	~cbAndRect() { delete cb; }
-};
 struct cbAndView {
-	W::Callback *cb;
+	W::Callback cb;
 	W::View *v;
-	cbAndView(W::Callback *_cb, W::View *_v) { cb = _cb; v = _v; }
-	~cbAndView() { delete cb; }
+	cbAndView() : v(NULL) { }
+	cbAndView(const W::Callback &_cb, W::View *_v) : cb(_cb), v(_v) { }
+};
+struct touchSub {
+	int touchID;
+	W::Callback cb;
+	touchSub(int _id, const W::Callback &_cb) : touchID(_id), cb(_cb) { }
 };
 
-struct W::Messenger::MState {
+#define N_POSITIONAL_TYPES W::ViewSubscriptions::NTypes
+#define POSITIONAL_INDEX(t) ((t) - W::EventType::MouseMove)
+#define N_UI_TYPES (W::EventType::ButtonClick - W::EventType::ButtonClick + 1)
+#define UI_INDEX(id, t) ((id) * N_UI_TYPES + (t) - W::EventType::ButtonClick)
+#define RECT_INDEX_THRESHOLD 16
+	// Views with fewer positional subscriptions of a type than this are scanned linearly
+
+struct W::MessengerInstance::MState {
 	MState()
 	{
 		// hai
@@ -43,107 +52,424 @@ struct W::Messenger::MState {
 	~MState()
 	{
 		// TODO: Messenger could destroy everything the user has forgotten to unsubscribe on destruct
+		for (int i=0; i < (int) typeSubs.size(); ++i)
+			delete typeSubs[i];
+		for (int i=0; i < (int) uiSubs.size(); ++i)
+			delete uiSubs[i];
+	}
+	
+	SubList& typeSubsFor(EventType::T t) {
+		if (t >= (int) typeSubs.size()) typeSubs.resize(t + 1, NULL);
+		if (!typeSubs[t]) typeSubs[t] = new SubList;
+		return *typeSubs[t];
+	}
+	SubList& uiSubsFor(int elementID, EventType::T t) {
+		int i = UI_INDEX(elementID, t);
+		if (i >= (int) uiSubs.size()) uiSubs.resize(i + 1, NULL);
+		if (!uiSubs[i]) uiSubs[i] = new SubList;
+		return *uiSubs[i];
+	}
+	
+	vector<SubList*>                         typeSubs;		// Indexed by type
+	vector<touchSub>                         touchSubs;	// Few touches at once, so scan
+	vector<SubList*>                         uiSubs;		// Indexed by UI_INDEX(element ID, type)
+	vector<vector<BatchCallback>>            batchSubs;	// Indexed by type. Removed: cleared, then compacted outside dispatch
+	
+	cbAndView globalPERs[N_POSITIONAL_TYPES];	// Indexed by positional type
+	
+	// Positional subs & view PERs are held by the View: see ViewSubscriptions
+};
+
+
+void compactBatchList(std::vector<W::BatchCallback> &l) {
+	// Remove cleared entries, preserving order
+	int out = 0;
+	for (int j=0; j < (int) l.size(); ++j)
+		if (l[j].isSet()) l[out++] = l[j];
+	l.resize(out);
+}
+
+
+#pragma mark - MessengerInstance
+
+// Each subscription has a slot, recording where it is, so that it can be
+// found from its Subscription token in O(1). Slots are reused: the
+// generation number distinguishes a token for a slot's previous occupant.
+// - Slots of the same resp are linked, for unsubscribeAll()
+
+struct W::MessengerInstance::Objs {
+	Objs() :
+		s(NULL),
+		activeGS(NULL),
+		prev_activeGS(NULL),
+		epoch(0),
+		dispatchDepth(0),
+		firstFreeSlot(-1)
+	{
+		// hai
 	}
 	
-	map<EventType::T, vector<Callback*>>              typeSubs;
-	map<View*, map<EventType::T, vector<cbAndRect*>>> positionalSubs;
-	map<int, Callback*>                               touchSubs;
-	map<string, map<EventType::T, vector<Callback*>>> uiSubs;
+	map<GameState*, MState*> stateMap;
+	MState *s;	// The active state
+	
+	GameState *activeGS;
+	GameState *prev_activeGS;
+	
+	unsigned int epoch;	// Bumped whenever callbacks may have moved subscribers' rects
+	int dispatchDepth;	// Removed subscriptions are compacted away when 0
+	
+	struct SubSlot {
+		SubList *list;	// NULL if free
+		int i;			// Index in list
+		unsigned int gen;
+		void *resp;
+		int prevOfResp, nextOfResp;
+		int nextFree;
+	};
+	vector<SubSlot> slots;
+	int firstFreeSlot;
+	std::unordered_map<void*, int> firstSlotOfResp;
+	vector<SubList*> compactionQueue;
+	vector<ViewSubscriptions*> deadViewSubs;	// Of views deleted during dispatch
+	
+	vector<int> candidates;		// Stack of index candidates being dispatched to
+	
+	vector<int> batchCounts;		// Reused by dispatchBatches
+	vector<Event> batchEvents;		//
+	
+	Subscription addSub(MessengerInstance *owner, SubList &l, const Callback &c, fRect *rct) {
+		int sl = firstFreeSlot;
+		if (sl >= 0) firstFreeSlot = slots[sl].nextFree;
+		else {
+			sl = (int) slots.size();
+			SubSlot blank = { NULL, 0, 0, NULL, -1, -1, -1 };
+			slots.push_back(blank);
+		}
+		SubSlot &x = slots[sl];
+		x.list = &l;
+		x.i = (int) l.subs.size();
+		x.resp = c.resp;
+		x.prevOfResp = x.nextOfResp = -1;
+		if (c.resp) {
+			std::unordered_map<void*, int>::iterator it = firstSlotOfResp.find(c.resp);
+			if (it != firstSlotOfResp.end()) {
+				x.nextOfResp = it->second;
+				slots[it->second].prevOfResp = sl;
+				it->second = sl;
+			}
+			else firstSlotOfResp[c.resp] = sl;
+		}
+		
+		l.owner = owner;
+		l.subs.push_back(cbAndRect(c, rct));
+		l.subs.back().slot = sl;
+		l.changed();
+		
+		Subscription token;
+		token.slot = sl, token.gen = x.gen;
+		return token;
+	}
+	
+	void freeSlot(int sl) {
+		SubSlot &x = slots[sl];
+		if (x.resp) {
+			if (x.prevOfResp >= 0) slots[x.prevOfResp].nextOfResp = x.nextOfResp;
+			else if (x.nextOfResp >= 0) firstSlotOfResp[x.resp] = x.nextOfResp;
+			else firstSlotOfResp.erase(x.resp);
+			if (x.nextOfResp >= 0) slots[x.nextOfResp].prevOfResp = x.prevOfResp;
+		}
+		x.list = NULL;
+		x.resp = NULL;
+		++x.gen;
+		x.nextFree = firstFreeSlot;
+		firstFreeSlot = sl;
+	}
+	
+	void removeSub(SubList &l, int i) {
+		cbAndRect &e = l.subs[i];
+		if (e.slot < 0) return;
+		freeSlot(e.slot);
+		e.slot = -1;
+		e.cb.clear();
+		e.rct = NULL;
+		++l.nDead;
+		l.changed();
+		if (!l.queuedForCompaction) {
+			l.queuedForCompaction = true;
+			compactionQueue.push_back(&l);
+		}
+	}
+	
+	void compact(SubList &l) {
+		// Preserve order, since dispatch order depends on it
+		int n = (int) l.subs.size(), out = 0;
+		for (int i=0; i < n; ++i) {
+			cbAndRect &e = l.subs[i];
+			if (e.slot < 0) continue;
+			if (out != i) {
+				l.subs[out] = e;
+				slots[e.slot].i = out;
+			}
+			++out;
+		}
+		l.subs.erase(l.subs.begin() + out, l.subs.end());
+		l.nDead = 0;
+		l.queuedForCompaction = false;
+		l.changed();
+	}
 	
-	map<View*, map<EventType::T, Callback*>> viewPERs;
-	map<EventType::T, cbAndView*> globalPERs;
+	void compactQueued() {
+		for (int i=0; i < (int) deadViewSubs.size(); ++i)
+			delete deadViewSubs[i];		// Removes their lists from the queue
+		deadViewSubs.clear();
+		
+		for (int i=0; i < (int) compactionQueue.size(); ++i)
+			compact(*compactionQueue[i]);
+		compactionQueue.clear();
+	}
 };
 
+W::MessengerInstance::MessengerInstance() :
+	objs(new Objs)
+{
+	// hai
+}
+W::MessengerInstance::~MessengerInstance()
+{
+	for (map<GameState*, MState*>::iterator it = objs->stateMap.begin(); it != objs->stateMap.end(); ++it)
+		delete it->second;
+	if (objs->s && objs->stateMap.find(objs->activeGS) == objs->stateMap.end())
+		delete objs->s;		// Temporary state not yet handed to a gamestate
+	delete objs;
+}
+
+
+#pragma mark - SubList
+
+W::SubList::SubList() :
+	nDead(0),
+	queuedForCompaction(false),
+	index(NULL),
+	owner(NULL)
+{
+	// hai
+}
+W::SubList::~SubList()
+{
+	if (owner) {
+		MessengerInstance::Objs &m = *owner->objs;
+		for (std::vector<cbAndRect>::iterator it = subs.begin(); it < subs.end(); ++it)
+			if (it->slot >= 0)
+				m.freeSlot(it->slot);
+		if (queuedForCompaction)
+			for (std::vector<SubList*>::iterator it = m.compactionQueue.begin(); it < m.compactionQueue.end(); ++it)
+				if (*it == this) {
+					m.compactionQueue.erase(it);
+					break;
+				}
+	}
+	delete index;
+}
+void W::SubList::changed() {
+	if (index) index->invalidate();
+}
+
+
+#pragma mark - ViewSubscriptions
+
+W::ViewSubscriptions::ViewSubscriptions() :
+	dead(false)
+{
+	// hai
+}
+W::ViewSubscriptions::~ViewSubscriptions()
+{
+	// bai
+}
+
 
 /********************************/
 /*** Messenger implementation ***/
 /********************************/
 
-std::map<W::GameState*, W::Messenger::MState*> W::Messenger::stateMap;
-W::Messenger::MState *W::Messenger::s = NULL;
-W::GameState *W::Messenger::activeGS = NULL;
-W::GameState *W::Messenger::prev_activeGS = NULL;
+namespace {
+	thread_local W::MessengerInstance *currentInst = NULL;
+}
+
+W::MessengerInstance* W::Messenger::defaultInstance() {
+	static MessengerInstance *def = new MessengerInstance;
+	return def;
+}
+W::MessengerInstance* W::Messenger::currentInstance() {
+	return currentInst ? currentInst : defaultInstance();
+}
+void W::Messenger::setCurrentInstance(MessengerInstance *inst) {
+	currentInst = inst;
+}
+W::Messenger::Objs& W::Messenger::cur() {
+	return *currentInstance()->objs;
+}
+
 
 #pragma mark - Dispatch methods
 
-bool W::Messenger::dispatchEvent(Event ev) {
-	if (!s) return false;
-	if (!activeGS) return false;
+bool W::Messenger::dispatchEvent(const Event &ev) {
+	// Callbacks may unsubscribe, or dispatch further events: only compact
+	// lists once the outermost dispatch is done
+	Objs &m = cur();
+	++m.dispatchDepth;
+	bool dispatched = _dispatchEvent(m, ev);
+	if (dispatched) ++m.epoch;
+	if (--m.dispatchDepth == 0)
+		m.compactQueued();
+	return dispatched;
+}
+
+void W::Messenger::_viewDestroyed(View *v) {
+	// Free the view's subscriptions - or, if a callback is deleting the view
+	// mid-dispatch, mark them dead & free them once the dispatch returns
+	Objs &m = cur();
+	ViewSubscriptions *vs = v->_subs;
+	v->_subs = NULL;
+	vs->dead = true;
+	if (m.dispatchDepth > 0) m.deadViewSubs.push_back(vs);
+	else delete vs;
+}
+
+void W::Messenger::_newFrame() {
+	Objs &m = cur();
+	++m.epoch;
+	if (m.dispatchDepth == 0)
+		m.compactQueued();
+}
+
+bool W::Messenger::_dispatchEvent(Objs &m, const Event &ev) {
+	if (!m.s) return false;
+	if (!m.activeGS) return false;
 	
 	if (_isPositional(ev)) {
+		Event vev = ev;		// Copy to convert to view coords (Events are trivially copyable)
+		
 		// If there is a global PER for this event type, translate coords using its view & dispatch
-		map<EventType::T, cbAndView*>::iterator itGPER = s->globalPERs.find(ev.type);
-		if (itGPER != s->globalPERs.end()) {
-			itGPER->second->v->_convertEventCoords(ev);
-			itGPER->second->cb->call(ev);
+		cbAndView &gper = m.s->globalPERs[POSITIONAL_INDEX(ev.type)];
+		if (gper.cb.isSet()) {
+			gper.v->_convertEventCoords(vev);
+			Callback cb = gper.cb;		// Copy, since the PER may relinquish itself
+			cb.call(vev);
 			return true;
 		}
 		
 		// Find view underneath event, if any
-		View *v = lastViewBeneathEvent(ev);
+		View *v = lastViewBeneathEvent(m, ev);
 		if (!v) return false;
 		
 		// Convert event's coords to view frame
-		v->_convertEventCoords(ev);
+		v->_convertEventCoords(vev);
 		
 		// Dispatch using mouse or touch system
-		if (_isMouse(ev)) return dispMouse(ev, v);
-		if (_isTouch(ev)) return dispTouch(ev, v);
+		if (_isMouse(vev)) return dispMouse(m, vev, v);
+		if (_isTouch(vev)) return dispTouch(m, vev, v);
 	}
 	
-	if (_isUI(ev)) return dispUI(ev);
+	if (_isUI(ev)) return dispUI(m, ev);
 	
 	// Dispatch to "normal" event type subscriptions
+	if (ev.type >= (int) m.s->typeSubs.size() || !m.s->typeSubs[ev.type])
+		return false;
+	return dispList(*m.s->typeSubs[ev.type], ev);
+}
+
+bool W::Messenger::dispList(SubList &l, const Event &ev) {
+	// Subscriptions added meanwhile are not called until the next event.
+	// Entries are not erased during dispatch, so indices remain valid.
 	bool dispatched = false;
-	map<EventType::T, vector<Callback*>>::iterator it = s->typeSubs.find(ev.type);
-	if (it != s->typeSubs.end()) {
-		vector<Callback*> &cblist = it->second;
-		for (std::vector<Callback*>::reverse_iterator it2 = cblist.rbegin(); it2 != cblist.rend(); ++it2)
-			if (cblist.size()) {
-				Callback &cb = **it2;
-				dispatched = true;
-				if (cb.call(ev) == W::EventPropagation::ShouldStop)
-					break;
-			}
+	for (int i = (int) l.subs.size() - 1; i >= 0; --i) {
+		if (l.subs[i].slot < 0) continue;
+		Callback cb = l.subs[i].cb;		// Copy, as the entry may be removed or moved during the call
+		dispatched = true;
+		if (cb.call(ev) == W::EventPropagation::ShouldStop)
+			break;
 	}
 	return dispatched;
 }
 
-bool W::Messenger::dispMouse(Event ev, View *v) {
-	// If there is a view-specific PER for this event type, dispatch to it
-	map<View*, map<EventType::T, Callback*>>::iterator itVPER = s->viewPERs.find(v);
-	if (itVPER != s->viewPERs.end()) {
-		map<EventType::T, Callback*> &typeSubsForView = itVPER->second;
-		map<EventType::T, Callback*>::iterator it = typeSubsForView.find(ev.type);
-		if (it != typeSubsForView.end()) {
-			it->second->call(ev);			// Dispatch
-			return true;
+void W::Messenger::dispatchBatches(const Event *evs, int n) {
+	W_PROFILE_ZONE("Messenger::dispatchBatches");
+	Objs &m = cur();
+	if (!m.s || !m.activeGS) return;
+	vector<vector<BatchCallback>> &batchSubs = m.s->batchSubs;
+	int nTypes = (int) batchSubs.size();
+	
+	// Compact away entries removed during dispatch since the last call
+	if (m.dispatchDepth == 0)
+		for (int t=0; t < nTypes; ++t)
+			compactBatchList(batchSubs[t]);
+	if (nTypes == 0) return;
+	
+	// Group by type (a counting sort, keeping order within each type), for
+	// only those types with batch subscribers
+	vector<int> &counts = m.batchCounts;
+	counts.assign(nTypes + 1, 0);
+	for (int i=0; i < n; ++i) {
+		EventType::T t = evs[i].type;
+		if (t >= 0 && t < nTypes && !batchSubs[t].empty()) ++counts[t+1];
+	}
+	for (int t=0; t < nTypes; ++t)
+		counts[t+1] += counts[t];
+	if (counts[nTypes] == 0) return;
+	
+	m.batchEvents.resize(counts[nTypes], Event(EventType::Unknown));
+	for (int i=0; i < n; ++i) {
+		EventType::T t = evs[i].type;
+		if (t >= 0 && t < nTypes && !batchSubs[t].empty())
+			m.batchEvents[counts[t]++] = evs[i];
+	}
+	// counts[t] is now the end of type t's span, & counts[t-1] its start
+	
+	++m.dispatchDepth;
+	for (int t=0; t < nTypes; ++t) {
+		int start = (t == 0 ? 0 : counts[t-1]), nEvs = counts[t] - start;
+		if (nEvs == 0) continue;
+		for (int j=0, nSubs=(int)batchSubs[t].size(); j < nSubs; ++j) {
+			BatchCallback cb = batchSubs[t][j];		// Copy, since it may unsubscribe
+			cb.call(&m.batchEvents[start], nEvs);
 		}
 	}
+	++m.epoch;
+	if (--m.dispatchDepth == 0) {
+		m.compactQueued();
+		for (int t=0; t < nTypes; ++t)
+			compactBatchList(batchSubs[t]);
+	}
+}
+
+bool W::Messenger::dispMouse(Objs &m, const Event &ev, View *v) {
+	// If there is a view-specific PER for this event type, dispatch to it
+	if (v->_subs->PERs[POSITIONAL_INDEX(ev.type)].isSet()) {
+		Callback vper = v->_subs->PERs[POSITIONAL_INDEX(ev.type)];
+		vper.call(ev);
+		return true;
+	}
 	
 	// Try dispatching using normal positioning system
-	if (dispPositionalInView(ev, v)) return true;
+	if (dispPositionalInView(m, ev, v)) return true;
 	
 	// As a final resort, send the event to the view underneath it
 	v->mouseEvent(ev);
 	return true;
 }
 
-bool W::Messenger::dispTouch(Event ev, View *v) {
+bool W::Messenger::dispTouch(Objs &m, const Event &ev, View *v) {
 	// For TouchDown events, test for view-specific PERs then try dispatching positionally
 	if (ev.type == EventType::TouchDown) {
 		// Test for PER
-		map<View*, map<EventType::T, Callback*>>::iterator itVPER = s->viewPERs.find(v);
-		if (itVPER != s->viewPERs.end()) {
-			map<EventType::T, Callback*> &typeSubsForView = itVPER->second;
-			map<EventType::T, Callback*>::iterator it = typeSubsForView.find(ev.type);
-			if (it != typeSubsForView.end()) {
-				it->second->call(ev);			// Dispatch
-				return true;
-			}
+		if (v->_subs->PERs[POSITIONAL_INDEX(ev.type)].isSet()) {
+			Callback vper = v->_subs->PERs[POSITIONAL_INDEX(ev.type)];
+			vper.call(ev);
+			return true;
 		}
 		// Try positionally
-		if (dispPositionalInView(ev, v)) return true;
+		if (dispPositionalInView(m, ev, v)) return true;
 
 		// As last resort, send to view underneath event
 		v->touchDown(ev);
@@ -151,71 +477,82 @@ bool W::Messenger::dispTouch(Event ev, View *v) {
 	}
 	
 	// For other touch events, send to subscriber to that touch id, if any
-	std::map<int, Callback*>::iterator it = s->touchSubs.find(ev.touchID);
-	if (it != s->touchSubs.end()) {
-		it->second->call(ev);
-		return true;
-	}
+	for (std::vector<touchSub>::iterator it = m.s->touchSubs.begin(); it < m.s->touchSubs.end(); ++it)
+		if (it->touchID == ev.touchID) {
+			Callback cb = it->cb;
+			cb.call(ev);
+			return true;
+		}
 	return false;
 }
 
-bool W::Messenger::dispUI(W::Event ev) {
-	const std::string elname = ev.payload;
-	
-	// If no subscriptions to this element, return false
-	map<string, map<EventType::T, vector<Callback*>>>::iterator it1 = s->uiSubs.find(elname);
-	if (it1 == s->uiSubs.end())
-		return false;
-	
-	// If no subscriptions to this event type for this element, return false
-	map<EventType::T, vector<Callback*>> &subs_for_element = it1->second;
-	map<EventType::T, vector<Callback*>>::iterator it2 = subs_for_element.find(ev.type);
-	if (it2 == subs_for_element.end())
+bool W::Messenger::dispUI(Objs &m, const W::Event &ev) {
+	// The payload is the element's interned name: no string lookup needed
+	int ind = UI_INDEX(ev.payload, ev.type);
+	if (ev.payload < 0 || ind >= (int) m.s->uiSubs.size() || !m.s->uiSubs[ind])
 		return false;
 	
 	// Call callbacks sub'd to this event type for this element
 	bool dispatched = false;
-	std::vector<Callback*> &callbacks = it2->second;
-	std::vector<Callback*>::iterator it3;
-	for (it3 = callbacks.begin(); it3 < callbacks.end(); it3++) {
+	SubList &l = *m.s->uiSubs[ind];
+	for (int i=0, n=(int)l.subs.size(); i < n; ++i) {
+		if (l.subs[i].slot < 0) continue;
+		Callback cb = l.subs[i].cb;
 		dispatched = true;
-		(*it3)->call(ev);
+		cb.call(ev);
 	}
 	
 	return dispatched;
 }
 
-bool W::Messenger::dispPositionalInView(Event ev, View *v) {
-	// If view does not have entry in s.positionalSubs, return false
-	map<View*, map<EventType::T, vector<cbAndRect*>>>::iterator itV = s->positionalSubs.find(v);
-	if (itV == s->positionalSubs.end())
-		return false;
-	
-	// If no subscriptions to this event type for that view, return false
-	map<EventType::T, vector<cbAndRect*>> &typeSubsForView = itV->second;
-	map<EventType::T, vector<cbAndRect*>>::iterator itT = typeSubsForView.find(ev.type);
-	if (itT == typeSubsForView.end())
-		return false;
-	
+bool W::Messenger::dispPositionalInView(Objs &m, const Event &ev, View *v) {
 	// Call callbacks sub'd to this event type for this view, in reverse order
+	// - Removed entries have a NULL rct
+	// - If a callback deletes the view, stop: its lists live on until the
+	//   outermost dispatch returns, but the view does not
 	bool dispatched = false;
-	std::vector<cbAndRect*> &callbacks = itT->second;
-	for (std::vector<cbAndRect*>::reverse_iterator it = callbacks.rbegin(); it != callbacks.rend(); ++it) {
-		cbAndRect &cnr = **it;
-		if (cnr.rct->overlapsWith(ev.pos)) {
+	ViewSubscriptions &vs = *v->_subs;
+	SubList &l = vs.positional[POSITIONAL_INDEX(ev.type)];
+	
+	if (l.subs.size() < RECT_INDEX_THRESHOLD) {
+		for (int i = (int) l.subs.size() - 1; i >= 0; --i) {
+			cbAndRect &cnr = l.subs[i];
+			if (cnr.rct && cnr.rct->overlapsWith(ev.pos)) {
+				dispatched = true;
+				Callback cb = cnr.cb;
+				if (cb.call(ev) == W::EventPropagation::ShouldStop || vs.dead)
+					break;
+			}
+		}
+		return dispatched;
+	}
+	
+	// Otherwise, only test the subscriptions in the index cell beneath the event.
+	// The cell holds subscription indices in ascending order, so walk it backwards.
+	// - Callbacks that (un)subscribe or dispatch may rebuild the index, so the
+	//   cell is first copied onto the candidates stack
+	if (!l.index) l.index = new RectIndex();
+	const std::vector<int> *cands = l.index->candidatesAt(l.subs, ev.pos, m.epoch);
+	if (!cands) return false;
+	
+	int base = (int) m.candidates.size();
+	m.candidates.insert(m.candidates.end(), cands->begin(), cands->end());
+	for (int j = (int) m.candidates.size() - 1; j >= base; --j) {
+		cbAndRect &cnr = l.subs[m.candidates[j]];
+		if (cnr.rct && cnr.rct->overlapsWith(ev.pos)) {
 			dispatched = true;
-			if (cnr.cb->call(ev) == W::EventPropagation::ShouldStop)
+			Callback cb = cnr.cb;
+			if (cb.call(ev) == W::EventPropagation::ShouldStop || vs.dead)
 				break;
 		}
 	}
-	if (dispatched) return true;
-	
-	return false;
+	m.candidates.resize(base);
+	return dispatched;
 }
 
-W::View* W::Messenger::lastViewBeneathEvent(Event ev) {
+W::View* W::Messenger::lastViewBeneathEvent(Objs &m, const Event &ev) {
 	View *v = NULL;
-	for (GameState::Viewlist::reverse_iterator itV = activeGS->_vlist.rbegin(); itV != activeGS->_vlist.rend(); ++itV)
+	for (GameState::Viewlist::reverse_iterator itV = m.activeGS->_vlist.rbegin(); itV != m.activeGS->_vlist.rend(); ++itV)
 		if ((*itV)->getRct().overlapsWith(ev.pos)) {
 			v = *itV;
 			break;
@@ -231,57 +568,42 @@ W::View* W::Messenger::lastViewBeneathEvent(Event ev) {
 
 #pragma mark - Subscription methods
 
-void W::Messenger::subscribe(EventType::T t, const Callback &c) {
-	if (!s) return;
-	s->typeSubs[t].push_back(c.copy());
+W::Subscription W::Messenger::subscribe(EventType::T t, const Callback &c) {
+	Objs &m = cur();
+	if (!m.s) return Subscription();
+	return m.addSub(currentInstance(), m.s->typeSubsFor(t), c, NULL);
 }
 void W::Messenger::unsubscribe(EventType::T t, void *r) {
-	if (!s) return;
-	vector<Callback*> &cblist = s->typeSubs[t];
-	for (vector<Callback*>::iterator it = cblist.begin(); it < cblist.end(); )
-		if ((*it)->resp == r) {
-			delete *it;
-			it = cblist.erase(it);
-		}
-		else it++;
+	Objs &m = cur();
+	if (!m.s) return;
+	if (t >= (int) m.s->typeSubs.size() || !m.s->typeSubs[t]) return;
+	SubList &l = *m.s->typeSubs[t];
+	for (int i=0, n=(int)l.subs.size(); i < n; ++i)
+		if (l.subs[i].slot >= 0 && l.subs[i].cb.resp == r)
+			m.removeSub(l, i);
 }
 
-void W::Messenger::subscribeInView(View *v, W::EventType::T t, const W::Callback &c, fRect *rct) {
-	if (!s) return;
-	s->positionalSubs[v][t].push_back(new cbAndRect(c.copy(), rct));
+W::Subscription W::Messenger::subscribeInView(View *v, W::EventType::T t, const W::Callback &c, fRect *rct) {
+	Objs &m = cur();
+	if (!m.s) return Subscription();
+	if (!_isPositionalType(t)) return Subscription();
+	return m.addSub(currentInstance(), v->_subs->positional[POSITIONAL_INDEX(t)], c, rct);
 }
 void W::Messenger::unsubscribeInView(View *v, W::EventType::T t, void *r) {
-	if (!s) return;
-	
-	// If no map of type subs for this view, return
-	map<View*, map<EventType::T, vector<cbAndRect*>>>::iterator itV = s->positionalSubs.find(v);
-	if (itV == s->positionalSubs.end()) return;
-	
-	// If map of type subs does not have entry for this type, return
-	map<EventType::T, vector<cbAndRect*>> &typeSubsForView = itV->second;
-	map<EventType::T, vector<cbAndRect*>>::iterator itT = typeSubsForView.find(t);
-	if (itT == typeSubsForView.end()) return;
-	
-	// Iterate over entries, deleting if resp == r
-	std::vector<cbAndRect*> &callbacks = itT->second;
-	for (std::vector<cbAndRect*>::iterator it = callbacks.begin(); it < callbacks.end(); )
-		if ((*it)->cb->resp == r) {
-			delete *it;
-			it = callbacks.erase(it);
-		}
-		else ++it;
-	
-	// If no more callbacks for this type, delete type subscription for view
-	if (callbacks.empty())
-		typeSubsForView.erase(itT);
+	Objs &m = cur();
+	if (!m.s) return;
+	if (!_isPositionalType(t)) return;
 	
-	// If no more type subscriptions for this view, delete view from s.positionalSubs
-	if (typeSubsForView.empty())
-		s->positionalSubs.erase(itV);
+	// Iterate over entries, removing if resp == r
+	SubList &l = v->_subs->positional[POSITIONAL_INDEX(t)];
+	for (int i=0, n=(int)l.subs.size(); i < n; ++i)
+		if (l.subs[i].slot >= 0 && l.subs[i].cb.resp == r)
+			m.removeSub(l, i);
 }
 
 void W::Messenger::subscribeToMouseEvents(View *v, const Callback &c, fRect *rct) {
-	if (!s) return;
+	Objs &m = cur();
+	if (!m.s) return;
 	using namespace EventType;
 	subscribeInView(v, MouseMove, c, rct);
 	subscribeInView(v, LMouseDown, c, rct);
@@ -290,7 +612,8 @@ void W::Messenger::subscribeToMouseEvents(View *v, const Callback &c, fRect *rct
 	subscribeInView(v, RMouseUp, c, rct);
 }
 void W::Messenger::unsubscribeFromMouseEvents(W::View *v, void *r) {
-	if (!s) return;
+	Objs &m = cur();
+	if (!m.s) return;
 	using namespace EventType;
 	unsubscribeInView(v, MouseMove, r);
 	unsubscribeInView(v, LMouseDown, r);
@@ -300,172 +623,229 @@ void W::Messenger::unsubscribeFromMouseEvents(W::View *v, void *r) {
 }
 
 bool W::Messenger::subscribeToTouchEvent(int touchID, const W::Callback &c) {
-	if (!s) return false;
-	if (s->touchSubs.find(touchID) != s->touchSubs.end())
-		return false;
-	s->touchSubs[touchID] = c.copy();
+	Objs &m = cur();
+	if (!m.s) return false;
+	for (std::vector<touchSub>::iterator it = m.s->touchSubs.begin(); it < m.s->touchSubs.end(); ++it)
+		if (it->touchID == touchID)
+			return false;
+	m.s->touchSubs.push_back(touchSub(touchID, c));
 	return true;
 }
 void W::Messenger::unsubscribeFromTouchEvent(int touchID, void *r) {
-	if (!s) return;
+	Objs &m = cur();
+	if (!m.s) return;
 	
-	map<int, Callback*>::iterator it = s->touchSubs.find(touchID);
-	if (it == s->touchSubs.end()) return;
-	if (it->second->resp == r) {
-		delete it->second;
-		s->touchSubs.erase(it);
-	}
+	for (std::vector<touchSub>::iterator it = m.s->touchSubs.begin(); it < m.s->touchSubs.end(); ++it)
+		if (it->touchID == touchID) {
+			if (it->cb.resp == r)
+				m.s->touchSubs.erase(it);
+			return;
+		}
 }
 
-void W::Messenger::subscribeToUIEvent(const char *_elname, EventType::T t, const Callback &c) {
-	if (!s) return;
-	unsubscribeFromUIEvent(_elname, t, c.resp);
-	s->uiSubs[_elname][t].push_back(c.copy());
+W::Subscription W::Messenger::subscribeToUIEvent(const char *elname, EventType::T t, const Callback &c) {
+	return subscribeToUIEvent(Event::internString(elname), t, c);
 }
 void W::Messenger::unsubscribeFromUIEvent(const char *elname, EventType::T t, void *r) {
-	if (!s) return;
+	unsubscribeFromUIEvent(Event::internString(elname), t, r);
+}
+W::Subscription W::Messenger::subscribeToUIEvent(int elementID, EventType::T t, const Callback &c) {
+	Objs &m = cur();
+	if (!m.s) return Subscription();
+	if (elementID < 0 || !_isUIType(t)) return Subscription();
+	unsubscribeFromUIEvent(elementID, t, c.resp);
+	return m.addSub(currentInstance(), m.s->uiSubsFor(elementID, t), c, NULL);
+}
+void W::Messenger::unsubscribeFromUIEvent(int elementID, EventType::T t, void *r) {
+	Objs &m = cur();
+	if (!m.s) return;
+	if (elementID < 0 || !_isUIType(t)) return;
 	
-	// If no map of type subs for this element, return
-	map<string, map<EventType::T, vector<Callback*>>>::iterator itE = s->uiSubs.find(elname);
-	if (itE == s->uiSubs.end())
+	int ind = UI_INDEX(elementID, t);
+	if (ind >= (int) m.s->uiSubs.size() || !m.s->uiSubs[ind])
 		return;
 	
-	// If map of type subs does not have an entry for this type, return
-	map<EventType::T, vector<Callback*>> &typeSubsForElement = itE->second;
-	map<EventType::T, vector<Callback*>>::iterator itT = typeSubsForElement.find(t);
-	if (itT == typeSubsForElement.end())
-		return;
+	// Iterate over entries, removing if resp == r
+	SubList &l = *m.s->uiSubs[ind];
+	for (int i=0, n=(int)l.subs.size(); i < n; ++i)
+		if (l.subs[i].slot >= 0 && l.subs[i].cb.resp == r)
+			m.removeSub(l, i);
+}
+
+void W::Messenger::subscribeToBatch(EventType::T t, const BatchCallback &c) {
+	Objs &m = cur();
+	if (!m.s || t < 0) return;
+	if (t >= (int) m.s->batchSubs.size()) m.s->batchSubs.resize(t + 1);
+	m.s->batchSubs[t].push_back(c);
+}
+void W::Messenger::unsubscribeFromBatch(EventType::T t, void *r) {
+	Objs &m = cur();
+	if (!m.s || t < 0 || t >= (int) m.s->batchSubs.size()) return;
+	vector<BatchCallback> &l = m.s->batchSubs[t];
+	for (int i=0; i < (int) l.size(); ++i)
+		if (l[i].isSet() && l[i].resp == r)
+			l[i].clear();
 	
-	// Iterate over entries, deleting if resp == r
-	vector<Callback*> &callbacks = itT->second;
-	for (vector<Callback*>::iterator it = callbacks.begin(); it < callbacks.end(); )
-		if ((*it)->resp == r) {
-			delete *it;
-			it = callbacks.erase(it);
-		}
-		else it++;
+	// During dispatch, entries must stay put: dispatchBatches compacts later
+	if (m.dispatchDepth == 0)
+		compactBatchList(l);
+}
+
+void W::Messenger::unsubscribe(Subscription &token) {
+	Objs &m = cur();
+	if (token.slot >= 0 && token.slot < (int) m.slots.size()) {
+		Objs::SubSlot &x = m.slots[token.slot];
+		if (x.list && x.gen == token.gen)
+			m.removeSub(*x.list, x.i);
+	}
+	token = Subscription();
+}
+
+void W::Messenger::unsubscribeAll(void *r) {
+	Objs &m = cur();
+	if (!r) return;
+	
+	// Subscriptions, via resp's linked slots
+	std::unordered_map<void*, int>::iterator it = m.firstSlotOfResp.find(r);
+	while (it != m.firstSlotOfResp.end()) {
+		Objs::SubSlot &x = m.slots[it->second];
+		m.removeSub(*x.list, x.i);	// Unlinks the slot, so find the next first
+		it = m.firstSlotOfResp.find(r);
+	}
+	
+	if (!m.s) return;
 	
-	// If no more callbacks for this type, delete type subscription for element
-	if (callbacks.empty())
-		typeSubsForElement.erase(itT);
+	// Batch subscriptions
+	for (int t=0; t < (int) m.s->batchSubs.size(); ++t)
+		unsubscribeFromBatch(t, r);
 	
-	// If no more type subscriptoins for this element, delete element from uiSubs
-	if (typeSubsForElement.empty())
-		s->uiSubs.erase(itE);
+	// Touch subscriptions
+	for (std::vector<touchSub>::iterator itT = m.s->touchSubs.begin(); itT < m.s->touchSubs.end(); )
+		if (itT->cb.resp == r) itT = m.s->touchSubs.erase(itT);
+		else ++itT;
+	
+	// PERs
+	for (int i=0; i < N_POSITIONAL_TYPES; ++i)
+		if (m.s->globalPERs[i].cb.isSet() && m.s->globalPERs[i].cb.resp == r)
+			m.s->globalPERs[i] = cbAndView();
+	if (m.activeGS)
+		for (GameState::Viewlist::iterator itV = m.activeGS->_vlist.begin(); itV != m.activeGS->_vlist.end(); ++itV)
+			for (int i=0; i < N_POSITIONAL_TYPES; ++i) {
+				Callback &vper = (*itV)->_subs->PERs[i];
+				if (vper.isSet() && vper.resp == r)
+					vper.clear();
+			}
 }
 
 
 #pragma mark - Privileged Event Responder methods
 
 bool W::Messenger::requestPrivilegedEventResponderStatus(View *v, EventType::T t, const Callback &c, bool global) {
-	if (!s) return false;
-	return (global ? reqPERGlobally(v, t, c) : reqPERNonglobally(v, t, c));
+	Objs &m = cur();
+	if (!m.s) return false;
+	if (!_isPositionalType(t)) return false;
+	return (global ? reqPERGlobally(m, v, t, c) : reqPERNonglobally(v, t, c));
 }
 void W::Messenger::relinquishPrivilegedEventResponderStatus(View *v, EventType::T t, void *r, bool global) {
-	if (!s) return;
-	global ? relinqPERGlobally(v, t, r) : relinqPERNonglobally(v, t, r);
+	Objs &m = cur();
+	if (!m.s) return;
+	if (!_isPositionalType(t)) return;
+	global ? relinqPERGlobally(m, v, t, r) : relinqPERNonglobally(v, t, r);
 }
-bool W::Messenger::reqPERGlobally(View *v, EventType::T t, const Callback &c) {
+bool W::Messenger::reqPERGlobally(Objs &m, View *v, EventType::T t, const Callback &c) {
 	// Check if exists already
-	map<EventType::T, cbAndView*>::iterator it = s->globalPERs.find(t);
-	if (it != s->globalPERs.end())
+	cbAndView &gper = m.s->globalPERs[POSITIONAL_INDEX(t)];
+	if (gper.cb.isSet())
 		return false;
 	// Add per
-	s->globalPERs[t] = new cbAndView(c.copy(), v);
+	gper = cbAndView(c, v);
 	return true;
 }
 bool W::Messenger::reqPERNonglobally(View *v, EventType::T t, const Callback &c) {
-	// Check if exists already (without creating map entries)
-	map<View*, map<EventType::T, Callback*>>::iterator itV = s->viewPERs.find(v);
-	if (itV != s->viewPERs.end()) {
-		map<EventType::T, Callback*> &typePersForView = itV->second;
-		map<EventType::T, Callback*>::iterator itT = typePersForView.find(t);
-		if (itT != typePersForView.end())
-			return false;
-	}
+	// Check if exists already
+	Callback &vper = v->_subs->PERs[POSITIONAL_INDEX(t)];
+	if (vper.isSet())
+		return false;
 	// Add PER
-	s->viewPERs[v][t] = c.copy();
+	vper = c;
 	return true;
 }
-void W::Messenger::relinqPERGlobally(W::View *v, EventType::T t, void *r) {
+void W::Messenger::relinqPERGlobally(Objs &m, W::View *v, EventType::T t, void *r) {
 	// Delete entry if exists & resp == r
-	map<EventType::T, cbAndView*>::iterator it = s->globalPERs.find(t);
-	if (it != s->globalPERs.end() && it->second->cb->resp == r) {
-		delete it->second;
-		s->globalPERs.erase(it);
-	}
+	cbAndView &gper = m.s->globalPERs[POSITIONAL_INDEX(t)];
+	if (gper.cb.isSet() && gper.cb.resp == r)
+		gper = cbAndView();
 }
 void W::Messenger::relinqPERNonglobally(W::View *v, EventType::T t, void *r) {
-	// Check type sub map exists for this view
-	map<View*, map<EventType::T, Callback*>>::iterator itV = s->viewPERs.find(v);
-	if (itV == s->viewPERs.end())
-		return;
-	
 	// Delete callback if exists for this type & resp == r
-	map<EventType::T, Callback*> &typePersForView = itV->second;
-	map<EventType::T, Callback*>::iterator it = typePersForView.find(t);
-	if (it != typePersForView.end() && it->second->resp == r) {
-		delete it->second;
-		typePersForView.erase(it);
-		// If no more PERs for view, remove from s.typePers
-		if (typePersForView.empty())
-			s->viewPERs.erase(itV);
-	}
+	Callback &vper = v->_subs->PERs[POSITIONAL_INDEX(t)];
+	if (vper.isSet() && vper.resp == r)
+		vper.clear();
 }
 
 
 #pragma mark - GameState/MState management
 
 void W::Messenger::_useTemporaryState() {
-	prev_activeGS = activeGS;
-	activeGS = NULL;
-	s = new MState;
+	Objs &m = cur();
+	m.prev_activeGS = m.activeGS;
+	m.activeGS = NULL;
+	m.s = new MState;
 }
 void W::Messenger::_restorePreviousIfUsingTemporaryState() {
-  if (!activeGS && s && prev_activeGS) {
-    _setActiveGamestate(activeGS);
-    prev_activeGS = NULL;
+  Objs &m = cur();
+  if (!m.activeGS && m.s && m.prev_activeGS) {
+    _setActiveGamestate(m.activeGS);
+    m.prev_activeGS = NULL;
   }
 }
 void W::Messenger::_setActiveGamestate(W::GameState *_gs) {
+	Objs &m = cur();
 	map<GameState*, MState*>::iterator it;
 	// If temporary state, save it as this GS's state
-	if (s)
-		stateMap[_gs] = s;
+	if (m.s)
+		m.stateMap[_gs] = m.s;
 	// If GS has saved state, set as current
-	else if ((it = stateMap.find(_gs)) != stateMap.end())
-		s = it->second;
+	else if ((it = m.stateMap.find(_gs)) != m.stateMap.end())
+		m.s = it->second;
 	// Otherwise, create a new state for this GS
 	else
-		s = stateMap[_gs] = new MState;
+		m.s = m.stateMap[_gs] = new MState;
 	
-	activeGS = _gs;
+	m.activeGS = _gs;
 }
 void W::Messenger::_gamestateDestroyed(W::GameState *_gs) {
-	auto *s_prev_gs = stateMap[_gs];
+	Objs &m = cur();
+	auto *s_prev_gs = m.stateMap[_gs];
 	if (s_prev_gs) {
-		stateMap.erase(_gs);
+		m.stateMap.erase(_gs);
 		delete s_prev_gs;
 	}
-	s = NULL;
-	activeGS = NULL;
+	m.s = NULL;
+	m.activeGS = NULL;
 }
 
 
 #pragma mark - Event type identification
-bool W::Messenger::_isMouse(Event ev) {
+bool W::Messenger::_isMouse(const Event &ev) {
 	using namespace EventType;
 	return ev.type >= MouseMove && ev.type <= RMouseDown;
 }
-bool W::Messenger::_isTouch(Event ev) {
+bool W::Messenger::_isTouch(const Event &ev) {
 	using namespace EventType;
 	return ev.type >= TouchDown && ev.type <= TouchCancelled;
 }
-bool W::Messenger::_isPositional(Event ev) {
+bool W::Messenger::_isPositional(const Event &ev) {
+	return _isPositionalType(ev.type);
+}
+bool W::Messenger::_isPositionalType(EventType::T t) {
 	using namespace EventType;
-	return ev.type >= MouseMove && ev.type <= TouchCancelled;
+	return t >= MouseMove && t <= TouchCancelled;
+}
+bool W::Messenger::_isUI(const Event &ev) {
+	return _isUIType(ev.type);
 }
-bool W::Messenger::_isUI(Event ev) {
+bool W::Messenger::_isUIType(EventType::T t) {
 	using namespace EventType;
-	return ev.type >= ButtonClick && ev.type <= ButtonClick;	// lol
+	return t >= ButtonClick && t <= ButtonClick;	// lol
 }
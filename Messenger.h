@@ -17,24 +17,113 @@
 #include <map>
 
 #include "Event.h"
+#include "Callback.h"
 
 namespace W {
 	
 	class EventResponder;
-	class Callback;
 	class GameState;
 	class View;
+	class RectIndex;
+	
+	// Returned by the subscribe methods: pass to unsubscribe() to remove the
+	// subscription in O(1)
+	struct Subscription {
+		Subscription() : slot(-1), gen(0) { }
+		int slot;
+		unsigned int gen;
+	};
+	
+	struct cbAndRect {
+		Callback cb;
+		fRect *rct;		// NULL if not positional
+		int slot;		// The subscription's slot in Messenger, or -1 once removed
+		cbAndRect(const Callback &_cb, fRect *_rct) : cb(_cb), rct(_rct), slot(-1) { }
+	};
+	
+	// Each MessengerInstance is an independent event world: its own gamestates,
+	// subscriptions & dispatch state. Messenger's static methods act on the
+	// calling thread's current instance - the default one, unless set with
+	// Messenger::setCurrentInstance().
+	// - Separate instances may dispatch concurrently on separate threads. An
+	//   instance itself, like W in general, should be used from one thread.
+	// - Destroy an instance's gamestates & views before the instance.
+	
+	class MessengerInstance {
+	public:
+		MessengerInstance();
+		~MessengerInstance();
+	private:
+		MessengerInstance(const MessengerInstance &);
+		MessengerInstance& operator= (const MessengerInstance &);
+		
+		struct MState;	// Subscriptions for one gamestate
+		struct Objs;
+		Objs *objs;
+		
+		friend class Messenger;
+		friend class SubList;
+	};
+	
+	// A list of subscriptions, dispatched to in reverse order.
+	// - Removing a subscription clears its entry in place, so is safe during
+	//   dispatch. Messenger compacts the list when no dispatch is in progress.
+	
+	class SubList {
+	public:
+		SubList();
+		~SubList();
+		
+		void changed();	// Invalidates the index, if any
+		
+		std::vector<cbAndRect> subs;
+		int nDead;
+		bool queuedForCompaction;
+		RectIndex *index;	// Positional lists only, created on demand
+		MessengerInstance *owner;	// Set when first subscribed to
+		
+	private:
+		SubList(const SubList &);				// Messenger's subscription slots
+		SubList& operator= (const SubList &);	// point to lists: no copying
+	};
+	
+	// Each View holds its own positional subscriptions & PERs, so dispatching
+	// to the view beneath an event needs no further lookup.
+	// - Tables are indexed by (type - EventType::MouseMove)
+	// - Once a view has more than a few subscriptions of a type, hit-testing
+	//   uses a spatial index over their rects
+	
+	// - A callback may delete the view it is dispatched in: its subscriptions
+	//   are then marked dead, & freed once the outermost dispatch returns
+	
+	struct ViewSubscriptions {
+		enum { NTypes = EventType::TouchCancelled - EventType::MouseMove + 1 };
+		
+		ViewSubscriptions();
+		~ViewSubscriptions();
+		
+		SubList positional[NTypes];
+		Callback PERs[NTypes];
+		bool dead;
+		
+	private:
+		ViewSubscriptions(const ViewSubscriptions &);
+		ViewSubscriptions& operator= (const ViewSubscriptions &);
+	};
 	
 	class Messenger {
 	public:
 		// Dispatch
-		static bool dispatchEvent(Event);
+		static bool dispatchEvent(const Event &);
+		static void dispatchBatches(const Event *, int n);
+			// Groups the events by type & delivers them to batch subscribers.
+			// W calls this with each frame's events, after dispatching them.
 		
 		// Subscription
-		static void subscribe(EventType::T, const Callback &);
+		static Subscription subscribe(EventType::T, const Callback &);
 		static void unsubscribe(EventType::T, void*);
 		
-		static void subscribeInView(View*, EventType::T, const Callback &, fRect*);
+		static Subscription subscribeInView(View*, EventType::T, const Callback &, fRect*);
 		static void unsubscribeInView(View*, EventType::T, void*);
 		
 		static void subscribeToMouseEvents(View*, const Callback &, fRect*);
@@ -51,8 +140,30 @@ namespace W {
 		static bool subscribeToTouchEvent(int _touchID, const Callback &);
 		static void unsubscribeFromTouchEvent(int _touchID, void *);
 		
-		static void subscribeToUIEvent(const char *_element_name, EventType::T, const Callback &);
+		static Subscription subscribeToUIEvent(const char *_element_name, EventType::T, const Callback &);
 		static void unsubscribeFromUIEvent(const char *_element_name, EventType::T, void *);
+		static Subscription subscribeToUIEvent(int _element_id, EventType::T, const Callback &);
+		static void unsubscribeFromUIEvent(int _element_id, EventType::T, void *);
+			// UI elements are identified by their interned names - see Event::internString()
+			// & UIElement::getID(). UI events carry the ID as their payload.
+		
+		static void subscribeToBatch(EventType::T, const BatchCallback &);
+		static void unsubscribeFromBatch(EventType::T, void *);
+			// A batch subscriber receives all of a frame's events of a type in one
+			// call, in order. Positional events are not filtered by view or
+			// position, & remain in window coordinates.
+		
+		static void unsubscribe(Subscription &);
+			// Removes the subscription, if it still exists, and resets the token
+		static void unsubscribeAll(void *resp);
+			// Removes all of resp's subscriptions - including batch & touch
+			// subscriptions, & PERs in the active gamestate
+		
+		// Instances
+		static void setCurrentInstance(MessengerInstance *);
+			// Sets the calling thread's instance. NULL for the default instance.
+		static MessengerInstance* currentInstance();
+		static MessengerInstance* defaultInstance();
 		
 		// GameState/State management
 		static void _useTemporaryState();	// Save subscriptions in a temporary state, for transferral in setActive~
@@ -60,35 +171,43 @@ namespace W {
 		static void _setActiveGamestate(GameState *);
 		static void _gamestateDestroyed(GameState *);
 		
+		static void _viewDestroyed(View *);
+		
+		static void _newFrame();
+			// Subscribers' rects may move during update() or any callback:
+			// spatial indices check for this when first used after either.
+			// Also compacts lists with removed subscriptions.
+		
 	private:
 		Messenger() { }
 		
-		struct MState;
-		static std::map<GameState*, MState*> stateMap;
-		static MState *s;	// The active state
-		
-		static GameState *activeGS;
-		static GameState *prev_activeGS;
+		typedef MessengerInstance::MState MState;
+		typedef MessengerInstance::Objs Objs;
+		static Objs& cur();
 		
 		// Private dispatch methods
-		static bool dispMouse(Event, View*);
-		static bool dispTouch(Event, View*);
-		static bool dispUI(Event);
+		static bool _dispatchEvent(Objs &, const Event &);
+		static bool dispList(SubList &, const Event &);
+		static bool dispMouse(Objs &, const Event &, View*);
+		static bool dispTouch(Objs &, const Event &, View*);
+		static bool dispUI(Objs &, const Event &);
 		
-		static bool dispPositionalInView(Event, View*);
-		static View* lastViewBeneathEvent(Event);
+		static bool dispPositionalInView(Objs &, const Event &, View*);
+		static View* lastViewBeneathEvent(Objs &, const Event &);
 		
 		// Private PER subscription methods
-		static bool reqPERGlobally(View*, EventType::T, const Callback &);
+		static bool reqPERGlobally(Objs &, View*, EventType::T, const Callback &);
 		static bool reqPERNonglobally(View*, EventType::T, const Callback &);
-		static void relinqPERGlobally(View*, EventType::T, void*);
+		static void relinqPERGlobally(Objs &, View*, EventType::T, void*);
 		static void relinqPERNonglobally(View*, EventType::T, void*);
 		
 		// Event typing methods
-		static bool _isMouse(Event);
-		static bool _isTouch(Event);
-		static bool _isPositional(Event);
-		static bool _isUI(Event);
+		static bool _isMouse(const Event &);
+		static bool _isTouch(const Event &);
+		static bool _isPositional(const Event &);
+		static bool _isPositionalType(EventType::T);
+		static bool _isUI(const Event &);
+		static bool _isUIType(EventType::T);
 	};
 	
 }
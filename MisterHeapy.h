@@ -66,6 +66,8 @@
  *     contiguous area of memory
  *   - obviously enough, that your elements do not move in memory after you have added pointers to them to the heap
  *
+ * If your elements aren't contiguous, use HandleHeapy instead.
+ *
  */
 
 #ifndef MISTERHEAPY_H
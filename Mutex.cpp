@@ -23,12 +23,12 @@ W::Mutex::~Mutex()
 	destroyMutex();
 }
 
-/******************************************/
-/*** Mutex: Mac-specific implementation ***/
-/******************************************/
+/**********************************************/
+/*** Mutex: Mac, iOS & Linux implementation ***/
+/**********************************************/
 
-#if defined WTARGET_MAC || defined WTARGET_IOS
-#pragma mark - Mac/iOS impl
+#if defined WTARGET_MAC || defined WTARGET_IOS || defined WTARGET_LINUX
+#pragma mark - Mac/iOS/Linux impl
 
 #include <pthread.h>
 
@@ -12,6 +12,7 @@
 
 #include "NavMap.h"
 #include "Log.h"
+#include "Profiler.h"
 #include <algorithm>
 #include <tuple>
 
@@ -202,6 +203,7 @@ bool W::NavMap::isPassableUnder(std::vector<W::v2i> v) {
 }
 
 bool W::NavMap::getRoute(int fromX, int fromY, int toX, int toY, std::vector<v2i> &route) {
+	W_PROFILE_ZONE("NavMap::getRoute");
 	route.clear();
 	
 	if (fromX < 0 || fromX >= w || fromY < 0 || fromY >= h || toX < 0 || toX >= w || toY < 0 || toY >= h) {
@@ -0,0 +1,143 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ================
+ *  Profiler.cpp
+ * ================
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+#include "Profiler.h"
+
+#ifdef W_PROFILING
+
+#include "Mutex.h"
+#include "Log.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+	
+	struct ZoneRecord {
+		const char *name;
+		long long start, end;	// ns
+	};
+	
+	// Each thread's ring: only its own thread writes, advancing head once a
+	// record is complete. Exporting reads behind head, & throws away anything
+	// the writer may have lapped in the meantime.
+	struct ThreadRing {
+		ThreadRing(int _tid) : tid(_tid), head(0), tail(0) { }
+		int tid;
+		std::atomic<unsigned long long> head;	// Records written, ever
+		std::atomic<unsigned long long> tail;	// Records before this were clear()ed
+		ZoneRecord zones[W::Profiler::RingSize];
+	};
+	
+	// Rings are never freed, so a thread's zones outlive it
+	W::Mutex ringsMutex;
+	std::vector<ThreadRing*> rings;
+	thread_local ThreadRing *threadRing = NULL;
+	
+	const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+	
+	long long now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+	}
+	
+	ThreadRing* ringForThisThread() {
+		if (!threadRing) {
+			ringsMutex.lock();
+			threadRing = new ThreadRing((int) rings.size() + 1);
+			rings.push_back(threadRing);
+			ringsMutex.unlock();
+		}
+		return threadRing;
+	}
+	
+	void writeEscaped(FILE *f, const char *s) {
+		for (; *s; ++s) {
+			if (*s == '"' || *s == '\\') fputc('\\', f);
+			if ((unsigned char) *s >= 0x20) fputc(*s, f);
+		}
+	}
+	
+}
+
+W::Profiler::ScopedZone::ScopedZone(const char *_name) : name(_name), start(now()) { }
+W::Profiler::ScopedZone::~ScopedZone()
+{
+	ThreadRing *r = ringForThisThread();
+	unsigned long long h = r->head.load(std::memory_order_relaxed);
+	ZoneRecord &z = r->zones[h % RingSize];
+	z.name = name;
+	z.start = start;
+	z.end = now();
+	r->head.store(h + 1, std::memory_order_release);
+}
+
+void W::Profiler::clear() {
+	ringsMutex.lock();
+	for (std::vector<ThreadRing*>::iterator it = rings.begin(); it < rings.end(); ++it)
+		(*it)->tail.store((*it)->head.load(std::memory_order_acquire));
+	ringsMutex.unlock();
+}
+
+bool W::Profiler::exportChromeTrace(const std::string &filename) {
+	FILE *f = fopen(filename.c_str(), "w");
+	if (!f) {
+		W::log << "Profiler: could not open '" << filename << "' for writing\n";
+		return false;
+	}
+	
+	fputs("{\"traceEvents\":[\n", f);
+	bool first = true;
+	std::vector<ZoneRecord> copy;
+	
+	ringsMutex.lock();
+	for (std::vector<ThreadRing*>::iterator it = rings.begin(); it < rings.end(); ++it) {
+		ThreadRing &r = **it;
+		
+		// Copy out the ring's contents, then discard any the writer has since overwritten
+		unsigned long long h1 = r.head.load(std::memory_order_acquire);
+		unsigned long long from = r.tail.load();
+		if (h1 - from > RingSize) from = h1 - RingSize;
+		copy.clear();
+		for (unsigned long long i = from; i < h1; ++i)
+			copy.push_back(r.zones[i % RingSize]);
+		unsigned long long h2 = r.head.load(std::memory_order_acquire);
+		unsigned long long nLapped = (h2 - from > RingSize ? h2 - from - RingSize : 0);
+		
+		for (unsigned long long i = nLapped; i < copy.size(); ++i) {
+			const ZoneRecord &z = copy[i];
+			fputs(first ? "" : ",\n", f);
+			fputs("{\"name\":\"", f);
+			writeEscaped(f, z.name);
+			fprintf(f, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+					z.start / 1000., (z.end - z.start) / 1000., r.tid);
+			first = false;
+		}
+	}
+	ringsMutex.unlock();
+	
+	fputs("\n],\"displayTimeUnit\":\"ns\"}\n", f);
+	bool ok = !ferror(f);
+	fclose(f);
+	return ok;
+}
+
+#else
+
+bool W::Profiler::exportChromeTrace(const std::string &) {
+	return false;
+}
+void W::Profiler::clear() { }
+W::Profiler::ScopedZone::ScopedZone(const char *_name) : name(_name), start(0) { }
+W::Profiler::ScopedZone::~ScopedZone() { }
+
+#endif
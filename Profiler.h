@@ -0,0 +1,60 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ==============
+ *  Profiler.h
+ * ==============
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+// Profiler records timing zones, for finding out where a frame's time went.
+// - W_PROFILE_ZONE("name") times the rest of the enclosing scope. W has zones
+//   around each phase of the update loop, event dispatch, pathfinding,
+//   storage compaction, atlas uploading & drawing each view; add your own
+//   in the same way.
+// - Each thread records into its own ring buffer, without locking. Each
+//   keeps its most recent Profiler::RingSize zones.
+// - exportChromeTrace() writes the recorded zones as Chrome trace event
+//   JSON: open it in chrome://tracing or ui.perfetto.dev.
+// - Zones are compiled in only if W_PROFILING is defined (for all of W, and
+//   your own code). Otherwise the macro expands to nothing, and
+//   exportChromeTrace() returns false.
+// - Zone names must be string literals, or otherwise outlive the profiler.
+
+#ifndef __W__Profiler
+#define __W__Profiler
+
+#include <string>
+
+namespace W {
+	
+	namespace Profiler {
+		enum { RingSize = 16384 };
+		
+		bool exportChromeTrace(const std::string &filename);
+		void clear();	// Discard all recorded zones
+		
+		class ScopedZone {
+		public:
+			ScopedZone(const char *_name);
+			~ScopedZone();
+		private:
+			const char *name;
+			long long start;
+		};
+	}
+	
+}
+
+#ifdef W_PROFILING
+	#define W_PROFILE_CONCAT_(a, b) a##b
+	#define W_PROFILE_CONCAT(a, b) W_PROFILE_CONCAT_(a, b)
+	#define W_PROFILE_ZONE(name) W::Profiler::ScopedZone W_PROFILE_CONCAT(_w_profile_zone_, __LINE__)(name)
+#else
+	#define W_PROFILE_ZONE(name)
+#endif
+
+#endif
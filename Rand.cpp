@@ -18,12 +18,13 @@
 #define A_BILLION 1000000000
 
 MTRand_int32 twister;
+unsigned int currentSeed;
 
 struct W::Rand::Init {
 	Init() {
 		time_t thetime;
 		time(&thetime);
-		twister.seed(thetime);
+		seed((unsigned int) thetime);
 	}
 };
 
@@ -37,3 +38,11 @@ float W::Rand::floatUpTo(float x) {
 	float y = twister()%A_BILLION;
 	return y/A_BILLION * x;
 }
+
+void W::Rand::seed(unsigned int s) {
+	currentSeed = s;
+	twister.seed(s);
+}
+unsigned int W::Rand::getSeed() {
+	return currentSeed;
+}
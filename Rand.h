@@ -22,6 +22,10 @@ namespace W {
 		static int intUpTo(int x);				// int in the interval [0,x-1]
 		static float floatUpTo(float x = 1.0);	// float in the interval [0..x]
 		
+		static void seed(unsigned int);
+		static unsigned int getSeed();
+			// Rand is seeded from the time at startup: reseed for a repeatable sequence
+		
 	private:
 		Rand() { }
 		
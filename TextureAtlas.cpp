@@ -12,6 +12,7 @@
 
 #include "TextureAtlas.h"
 #include "Log.h"
+#include "Profiler.h"
 #include "Drawable.h"
 #include "W_internal.h"
 
@@ -69,9 +70,11 @@ namespace W {
 /***********************************/
 
 std::set<W::TextureAtlas*> W::TextureAtlas::modifiedAtlases;
+unsigned int nextAtlasSortId = 0;
 W::TextureAtlas *W::TextureAtlas::_defaultTexAtlas = new W::TextureAtlas();
 
 W::TextureAtlas::TextureAtlas() :
+	sortId(nextAtlasSortId++),
 	data(NULL),
 	curTexPower(0),
 	glTexId(0)
@@ -82,6 +85,19 @@ W::TextureAtlas::TextureAtlas() :
 	topNode = new TANode;
 	topNode->rct.size = v2i(TANODE_FULL_SIZE);
 }
+W::TextureAtlas::~TextureAtlas()
+{
+	// The render thread may be drawing with the atlas
+	_waitForRenderThread();
+	modifiedAtlases.erase(this);
+	if (oglState.curBoundTexAtlas == this)
+		oglState.curBoundTexAtlas = NULL;
+	if (glTexId)
+		oglState._deletedTextures.push_back(glTexId);	// Deleted on the GL thread
+	
+	delete topNode;
+	free(data);
+}
 
 
 bool W::TextureAtlas::addTex(const std::string &filename, Texture *_tex) {
@@ -173,10 +189,11 @@ void W::TextureAtlas::allocate(int newTexPower) {
 }
 void W::TextureAtlas::updateTexcoords() {
 	for (std::set<DTexturedShape*>::iterator it = drawables.begin(); it != drawables.end(); ++it)
-		(*it)->recopyT();
+		(*it)->regenTexCoords();
 }
 void W::TextureAtlas::upload() {
 	if (!data) return;
+	W_PROFILE_ZONE("TextureAtlas::upload");
 	glDeleteTextures(1, &glTexId);
 	glTexId = SOIL_create_OGL_texture(
 		data,
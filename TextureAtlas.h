@@ -26,6 +26,7 @@ namespace  W {
 	class TextureAtlas {
 	public:
 		TextureAtlas();
+		~TextureAtlas();
 		bool addTex(const std::string &filename, W::Texture *);
 			// Adds the texture and calls setModified(), returning false if impossible
 		bool addTex(unsigned char *, v2i, W::Texture *);
@@ -55,6 +56,8 @@ namespace  W {
 		
 		static TextureAtlas* _defaultTexAtlas;
 		
+		const unsigned int sortId;	// Orders Views' draw batches by atlas
+	
 	private:
 		TANode *topNode;
 		
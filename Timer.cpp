@@ -35,7 +35,93 @@ THE SOFTWARE.
 #ifdef __APPLE__
 
 #include "Timer.h"
-#include <sys/time.h>
+#include <mach/mach_time.h>
+
+namespace {
+	// Converts mach_absolute_time() units to ns
+	unsigned long long machToNanoseconds(uint64_t t) {
+		static mach_timebase_info_data_t tb;
+		if (tb.denom == 0) mach_timebase_info(&tb);
+		return t * tb.numer / tb.denom;
+	}
+}
+
+W::Timer::Timer()
+{
+	reset();
+}
+
+W::Timer::~Timer()
+{
+	//
+}
+
+void W::Timer::reset() {
+	zeroClock = clock();
+	start = mach_absolute_time();
+}
+
+unsigned long W::Timer::getMilliseconds() {
+	return (unsigned long) (getNanoseconds() / 1000000);
+}
+
+unsigned long W::Timer::getMicroseconds() {
+	return (unsigned long) (getNanoseconds() / 1000);
+}
+
+unsigned long long W::Timer::getNanoseconds() {
+	return machToNanoseconds(mach_absolute_time() - start);
+}
+
+unsigned long W::Timer::getMillisecondsCPU() {
+	clock_t newClock = clock();
+	return (unsigned long)((float)(newClock-zeroClock) / ((float)CLOCKS_PER_SEC/1000.0)) ;
+}
+
+unsigned long W::Timer::getMicrosecondsCPU() {
+	clock_t newClock = clock();
+	return (unsigned long)((float)(newClock-zeroClock) / ((float)CLOCKS_PER_SEC/1000000.0)) ;
+}
+
+#elif defined __linux__
+
+#include "Timer.h"
+
+#if defined W_TIMER_TSC && (defined __x86_64__ || defined __i386__)
+	#define W_TIMER_USE_TSC
+	#include <x86intrin.h>
+	#include <cpuid.h>
+#endif
+
+namespace {
+	inline unsigned long long monotonicNanoseconds() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+}
+
+#ifdef W_TIMER_USE_TSC
+	// Calibrate the TSC against CLOCK_MONOTONIC, if it ticks at a constant
+	// rate regardless of core & power state
+	struct W::Timer::Init {
+		Init() : useTSC(false), nsPerTick(0) {
+			unsigned int a, b, c, d;
+			if (!__get_cpuid(0x80000007, &a, &b, &c, &d) || !(d & (1 << 8)))
+				return;
+			unsigned long long ns0 = monotonicNanoseconds(), t0 = __rdtsc();
+			while (monotonicNanoseconds() - ns0 < 5000000) ;
+			unsigned long long ns1 = monotonicNanoseconds(), t1 = __rdtsc();
+			nsPerTick = (double) (ns1 - ns0) / (t1 - t0);
+			useTSC = true;
+		}
+		bool useTSC;
+		double nsPerTick;
+	};
+	W::Timer::Init *W::Timer::init = new W::Timer::Init();
+#else
+	W::Timer::Init *W::Timer::init = NULL;
+#endif
 
 W::Timer::Timer()
 {
@@ -49,19 +135,32 @@ W::Timer::~Timer()
 
 void W::Timer::reset() {
 	zeroClock = clock();
-	gettimeofday(&start, NULL);
+	#ifdef W_TIMER_USE_TSC
+		usingTSC = (init && init->useTSC);
+		if (usingTSC) {
+			start = __rdtsc();
+			return;
+		}
+	#else
+		usingTSC = false;
+	#endif
+	start = monotonicNanoseconds();
 }
 
 unsigned long W::Timer::getMilliseconds() {
-	struct timeval now;
-	gettimeofday(&now, NULL);
-	return (now.tv_sec-start.tv_sec)*1000+(now.tv_usec-start.tv_usec)/1000;
+	return (unsigned long) (getNanoseconds() / 1000000);
 }
 
 unsigned long W::Timer::getMicroseconds() {
-	struct timeval now;
-	gettimeofday(&now, NULL);
-	return (now.tv_sec-start.tv_sec)*1000000+(now.tv_usec-start.tv_usec);
+	return (unsigned long) (getNanoseconds() / 1000);
+}
+
+unsigned long long W::Timer::getNanoseconds() {
+	#ifdef W_TIMER_USE_TSC
+		if (usingTSC)
+			return (unsigned long long) ((__rdtsc() - start) * init->nsPerTick);
+	#endif
+	return monotonicNanoseconds() - start;
 }
 
 unsigned long W::Timer::getMillisecondsCPU() {
@@ -204,6 +303,26 @@ unsigned long W::Timer::getMicroseconds() {
     return newMicro;
 }
 
+unsigned long long W::Timer::getNanoseconds() {
+	// QPC is consistent across cores on all current versions of Windows, so
+	// this skips the affinity pinning above, for use in hot loops
+	LARGE_INTEGER curTime;
+	QueryPerformanceCounter(&curTime);
+	LONGLONG t = curTime.QuadPart - mStartTime.QuadPart, f = mFrequency.QuadPart;
+	
+	// Compensate for leaps as above, so readings stay in step with theirs
+	unsigned long check = GetTickCount() - mStartTick;
+	signed long msecOff = (signed long)((unsigned long) (1000 * t / f) - check);
+	if (msecOff < -100 || msecOff > 100) {
+		LONGLONG adjust = (std::min)(msecOff * f / 1000, t - mLastTime);
+		mStartTime.QuadPart += adjust;
+		t -= adjust;
+	}
+	mLastTime = t;
+	
+	return (unsigned long long) ((t / f) * 1000000000LL + (t % f) * 1000000000LL / f);
+}
+
 unsigned long W::Timer::getMillisecondsCPU() {
 	clock_t newClock = clock();
 	return (unsigned long)( (float)( newClock - mZeroClock ) / ( (float)CLOCKS_PER_SEC / 1000.0 ) ) ;
@@ -35,7 +35,11 @@ THE SOFTWARE.
 #define Timer_H
 
 #ifdef __APPLE__
-	#include <sys/time.h>
+	#include <stdint.h>
+	#include <time.h>
+
+#elif defined __linux__
+	#include <time.h>
 
 #elif defined _WIN32 || _WIN64
 	#include <time.h>
@@ -52,6 +56,10 @@ THE SOFTWARE.
 
 #endif
 
+// - On Linux, the Timer uses CLOCK_MONOTONIC (read via the vDSO, so no
+//   syscall). Define W_TIMER_TSC to read the CPU's timestamp counter
+//   directly instead, on x86 CPUs whose TSC is invariant.
+
 namespace W
 {
 	
@@ -62,12 +70,20 @@ namespace W
 		void reset();		// Reset timer
 		unsigned long getMilliseconds();	// ms since init/reset
 		unsigned long getMicroseconds();	// µs since init/reset
+		unsigned long long getNanoseconds();	// ns since init/reset - monotonic, & cheap enough for hot loops
 		unsigned long getMillisecondsCPU();	// "only cpu time measured"
 		unsigned long getMicrosecondsCPU();	// ~
 	private:
 		#ifdef __APPLE__
-			struct timeval start;
+			uint64_t start;		// mach_absolute_time() units
+			clock_t zeroClock;
+		#elif defined __linux__
+			unsigned long long start;	// ns, or TSC ticks if usingTSC
+			bool usingTSC;
 			clock_t zeroClock;
+			
+			struct Init;
+			static Init *init;
 		#elif defined _WIN32 || _WIN64
 			clock_t mZeroClock;
 			DWORD mStartTick;
@@ -17,7 +17,7 @@
 #include "Drawable.h"
 
 W::UIElement::UIElement(const std::string &_name, W::Positioner _pos, View *_v) :
-	name(_name), positioner(_pos), view(_v)
+	name(_name), nameID(Event::internString(_name)), positioner(_pos), view(_v)
 {
 	//
 }
@@ -42,7 +42,7 @@ W::Button::Button(std::string _name, W::Positioner _pos, View *_v) :
 	buttonClickEvent(EventType::ButtonClick),
 	btnrect(NULL)
 {
-	buttonClickEvent.payload = name;
+	buttonClickEvent.payload = nameID;
 	
 	Callback cb(&Button::recEv, this);
 	Messenger::subscribeInView(view, EventType::MouseMove, cb, &rct);
@@ -52,11 +52,9 @@ W::Button::Button(std::string _name, W::Positioner _pos, View *_v) :
 W::Button::~Button()
 {
 	if (btnrect) delete btnrect;
-	Messenger::unsubscribeInView(view, EventType::MouseMove, this);
-	Messenger::unsubscribeInView(view, EventType::LMouseDown, this);
-	Messenger::unsubscribeInView(view, EventType::LMouseUp, this);
+	Messenger::unsubscribeAll(this);	// Including any PERs, if mid-click
 }
-W::EventPropagation::T W::Button::recEv(W::Event ev) {
+W::EventPropagation::T W::Button::recEv(const W::Event &ev) {
 	using namespace EventType;
 	
 	if (ev.type == LMouseDown) {
@@ -39,8 +39,12 @@ namespace W {
 		virtual void activate() = 0;
 		virtual void deactivate() = 0;
 		
+		int getID() { return nameID; }
+			// The interned name, as carried by this element's events
+		
 	protected:
 		std::string name;
+		int nameID;
 		W::Positioner positioner;
 		fRect rct;
 		View *view;
@@ -51,7 +55,7 @@ namespace W {
 	public:
 		Button(std::string _name, W::Positioner, View *);
 		~Button();
-		EventPropagation::T recEv(Event);
+		EventPropagation::T recEv(const Event &);
 		virtual void activate();
     virtual void deactivate();
     virtual void updatePosition();
@@ -67,7 +67,7 @@ void W::UIView::mouseEvent(Event ev) {
 		dragloop = true;
 	}
 }
-W::EventPropagation::T W::UIView::dragLoopEvent(Event ev) {
+W::EventPropagation::T W::UIView::dragLoopEvent(const Event &ev) {
 	using namespace EventType;
 	if (ev.type == MouseMove) {
 		cur_positioner->nudge(ev.pos - drag_initial);
@@ -30,7 +30,7 @@ namespace W {
 		~UIView();
 		
 		void mouseEvent(Event);
-		EventPropagation::T dragLoopEvent(Event);
+		EventPropagation::T dragLoopEvent(const Event &);
 //		void draw();
 		
 	protected:
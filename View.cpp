@@ -14,46 +14,32 @@
 #include "StorageObj.h"
 #include "Drawable.h"
 #include "W_internal.h"
+#include "TextureAtlas.h"
 
 #include "oglInclude.h"
+#include <algorithm>
+#include <cstddef>
 
 //#define __W_DEBUG
 #include "DebugMacro.h"
 
 #define GL_ARRAY_INITIAL_SIZE 256
-#define SECONDS_PER_COMPACT 10
 #define COMPACTION_THRESHOLD 0.3	// View will compact if (used_size <= CT * size)
 
 
-#pragma mark - Layer
+#pragma mark - DrawBatch
 
-/*************/
-/*** Layer ***/
-/*************/
+/*****************/
+/*** DrawBatch ***/
+/*****************/
 
-W::Layer::Layer()
-{
-	w_dout << " Layer() (" << this << ")\n";
-}
-W::Layer::~Layer()
-{
-	w_dout << " ~Layer() (" << this << ")\n";
-}
-void W::Layer::compact() {
-	std::map<BlendMode::T, StorageObjForColouredShapes*>::iterator itCGroups;
-	for (itCGroups = cGroups.begin(); itCGroups != cGroups.end(); ++itCGroups) {
-		w_dout << "  compacting coloured shapes group for blend mode " << itCGroups->first << "\n";
-		itCGroups->second->compact();
-	}
-	std::map<BlendMode::T, std::map<TextureAtlas*, StorageObjForTexturedShapes*> >::iterator itTGroups;
-	for (itTGroups = tGroups.begin(); itTGroups != tGroups.end(); ++itTGroups) {
-		std::map<TextureAtlas*, StorageObjForTexturedShapes*>::iterator itSObjs;
-		std::map<TextureAtlas*, StorageObjForTexturedShapes*> &sObjsMap = itTGroups->second;
-		for (itSObjs = sObjsMap.begin(); itSObjs != sObjsMap.end(); ++itSObjs) {
-			w_dout << "  compacting textured shapes group for blend mode " << itTGroups->first << " and tex atlas " << itSObjs->first << "\n";
-			itSObjs->second->compact();
-		}
-	}
+// Batches sort by layer, then coloured before textured, then blend mode, then atlas
+uint64_t W::DrawBatch::makeKey(int layer, BlendMode::T blendMode, TextureAtlas *atlas) {
+	return
+		(uint64_t) ((uint32_t) layer ^ 0x80000000u) << 32 |
+		(uint64_t) (atlas != NULL) << 31 |
+		(uint64_t) (blendMode & 0x7f) << 24 |
+		(atlas ? atlas->sortId & 0xffffff : 0);
 }
 
 
@@ -64,37 +50,30 @@ void W::Layer::compact() {
 /***************************/
 
 W::View::View(Positioner _pos) :
+	_subs(new ViewSubscriptions),
 	_positioner(_pos),
-	use_positioner(true),
-	frameCounter(0)
+	use_positioner(true)
 {
 		_updatePosition();
 }
 W::View::View() :
-	use_positioner(false),
-	frameCounter(0)
+	_subs(new ViewSubscriptions),
+	use_positioner(false)
 {
 	_updatePosition();
 }
 W::View::~View()
 {
-	// Delete all storage objects in all layers
-	for (std::map<int, Layer>::iterator it = layers.begin(); it != layers.end(); ++it) {
-		Layer &l = it->second;
-		
-		// Delete all coloured shape storage objects
-		std::map<BlendMode::T, StorageObjForColouredShapes*>::iterator it2;
-		for (it2 = l.cGroups.begin(); it2 != l.cGroups.end(); ++it2)
-			delete it2->second;
-		
-		// Delete all textured shape storage objects
-		std::map<BlendMode::T, std::map<TextureAtlas*, StorageObjForTexturedShapes*>>::iterator itBl;
-		for (itBl = l.tGroups.begin(); itBl != l.tGroups.end(); ++itBl) {
-			std::map<TextureAtlas*, StorageObjForTexturedShapes*> &atlasToSOMap = itBl->second;
-			std::map<TextureAtlas*, StorageObjForTexturedShapes*>::iterator itTA;
-			for (itTA = atlasToSOMap.begin(); itTA != atlasToSOMap.end(); ++itTA)
-				delete itTA->second;
-		}
+	Messenger::_viewDestroyed(this);
+	
+	// The render thread may still be drawing our storage. (Removing the view
+	// or popping its state waits earlier, before subclass destructors run.)
+	_waitForRenderThread();
+	
+	// Delete all storage objects
+	for (std::vector<DrawBatch>::iterator it = batches.begin(); it < batches.end(); ++it) {
+		delete it->cObj;
+		delete it->tObj;
 	}
 }
 
@@ -115,91 +94,136 @@ void W::View::_convertEventCoords(Event &ev) {
 }
 
 void W::View::_draw(v2i winSz) {
-	w_dout << "View::_draw(const size &winSz)\n";
+	gatherDrawCmds(false);
+	_submitDraw(winSz);
+}
+void W::View::_prepareDraw() {
+	gatherDrawCmds(true);
+}
+
+namespace {
+	template <class SO>
+	W::DrawCmd makeDrawCmd(SO *so, W::BlendMode::T blendMode, W::TextureAtlas *atlas, bool snapshot) {
+		W::DrawCmd cmd = { blendMode, atlas, so, so->v_array.array, so->v_array.used_size, 0, 0, so->v_array.capacity };
+		#ifdef W_VBOS
+			// Upload only the vertices changed since last drawn
+			int from = so->dirtyFrom, to = std::min(so->dirtyTo, so->v_array.used_size);
+			so->dirtyFrom = so->dirtyTo = 0;
+			if (from < to) {
+				cmd.uploadFrom = from;
+				cmd.uploadN = to - from;
+				if (snapshot) {
+					so->_snapshot(from, to);
+					cmd.vertices = &so->v_snapshot[0];
+				}
+				else
+					cmd.vertices = so->v_array.array + from;
+			}
+		#else
+			if (snapshot) {
+				so->_snapshot(0, so->v_array.used_size);
+				cmd.vertices = &so->v_snapshot[0];
+			}
+		#endif
+		return cmd;
+	}
+}
+
+void W::View::gatherDrawCmds(bool snapshot) {
+	// Gather the non-empty storage objects, in batch order. For pipelined
+	// rendering, draw from copies of their arrays (or with VBOs, of the
+	// changed parts), which the update thread is then free to modify.
+	drawCmds.clear();
+	drawRct = rct;
+	drawOffset = _offset;
+	
+	for (std::vector<DrawBatch>::iterator it = batches.begin(); it < batches.end(); ++it) {
+		DrawBatch &b = *it;
+		if (b.cObj && !b.cObj->isEmpty())
+			drawCmds.push_back(makeDrawCmd(b.cObj, b.blendMode, NULL, snapshot));
+		else if (b.tObj && !b.tObj->isEmpty())
+			drawCmds.push_back(makeDrawCmd(b.tObj, b.blendMode, b.atlas, snapshot));
+	}
+}
+
+void W::View::_submitDraw(v2i winSz) {
+	W_PROFILE_ZONE("View::_draw");
+	w_dout << "View::_submitDraw(const size &winSz)\n";
 	w_dout << " winsize: " << winSz.str() << "\n";
-	w_dout << " position:" << rct.position.str() << ", size:" << rct.size.str() << ", offset:" << _offset.str() << "\n";
+	w_dout << " position:" << drawRct.position.str() << ", size:" << drawRct.size.str() << ", offset:" << drawOffset.str() << "\n";
 	
-	v2i &sz = rct.size;			// Note: these properties are copied, to avoid artifacts in the event
-	v2i &pos = rct.position;		// that the view's position is updated while its objects are being drawn
-		// Note: they are no longer copied
+	v2i &sz = drawRct.size;
+	v2i &pos = drawRct.position;
 	
 	// Set up OGL: scissor to view bounds, translate to view pos w/ modelview matrix
 	glScissor(pos.a, winSz.b - pos.b - sz.b, sz.a, sz.b);
 	glLoadIdentity();
-	glTranslatef(pos.a + _offset.a, pos.b + _offset.b, 0);
+	glTranslatef(pos.a + drawOffset.a, pos.b + drawOffset.b, 0);
 	
 	// Users can write custom OpenGL code
 	customOpenGLDrawing();
 	
-	// To draw:
-	//  - iterate over Storage Objects in layer order
-	//  - switch the necessary opengl state on/off
-	//  - submit data arrays
-	
-	// For each layer...
-	for (std::map<int, Layer>::iterator it = layers.begin(); it != layers.end(); ++it) {
-		Layer &l = it->second;
+	// For each batch, switch the necessary opengl state on/off & submit its arrays
+	for (std::vector<DrawCmd>::iterator it = drawCmds.begin(); it < drawCmds.end(); ++it) {
+		DrawCmd &cmd = *it;
+		int stride = (cmd.atlas ? sizeof(TVertex) : sizeof(CVertex));
 		
-		// For each coloured shape storage object...
-		std::map<BlendMode::T, StorageObjForColouredShapes*>::iterator it2;
-		for (it2 = l.cGroups.begin(); it2 != l.cGroups.end(); ++it2) {
-			BlendMode::T blendMode = it2->first;
-			StorageObjForColouredShapes *&storageObj = it2->second;
-			if (!storageObj->isEmpty()) {
-				// Set up OGL features
-				oglState.setBlendMode(blendMode);
-				oglState.disableTexturing();
-				
-				// Submit data arrays
-				glVertexPointer(3, GL_FLOAT, 0, storageObj->v_array.array);
-				glColorPointer(4, GL_FLOAT, 0, storageObj->c_array.array);
-				glDrawArrays(GL_TRIANGLES, 0, storageObj->v_array.used_size);
+		#ifdef W_VBOS
+			// Bring the storage object's buffer up to date, then draw from it
+			StorageObj *so = cmd.storageObj;
+			if (!so->vbo)
+				glGenBuffers(1, &so->vbo);
+			glBindBuffer(GL_ARRAY_BUFFER, so->vbo);
+			if (so->vboCapacity != cmd.capacity) {
+				glBufferData(GL_ARRAY_BUFFER, cmd.capacity * stride, NULL, GL_DYNAMIC_DRAW);
+				so->vboCapacity = cmd.capacity;
 			}
-		}
+			if (cmd.uploadN)
+				glBufferSubData(GL_ARRAY_BUFFER, cmd.uploadFrom * stride, cmd.uploadN * stride, cmd.vertices);
+			const char *base = NULL;
+		#else
+			const char *base = (const char*) cmd.vertices;
+		#endif
 		
-		// For each textured shape storage object...
-		std::map<BlendMode::T, std::map<TextureAtlas*, StorageObjForTexturedShapes*>>::iterator itBl;
-		for (itBl = l.tGroups.begin(); itBl != l.tGroups.end(); ++itBl) {
-			std::map<TextureAtlas*, StorageObjForTexturedShapes*> &atlasToSOMap = itBl->second;
-			std::map<TextureAtlas*, StorageObjForTexturedShapes*>::iterator itTA;
-			for (itTA = atlasToSOMap.begin(); itTA != atlasToSOMap.end(); ++itTA) {
-				BlendMode::T blendMode = itBl->first;
-				TextureAtlas *texAtlas = itTA->first;
-				StorageObjForTexturedShapes *&storageObj = itTA->second;
-				if (!storageObj->isEmpty()) {
-					// Set up OGL
-					oglState.setBlendMode(blendMode);
-					oglState.enableTexturing();
-					
-					// Bind texture atlas
-					oglState.bindAtlas(texAtlas);
-					
-					// Submit
-					glVertexPointer(3, GL_FLOAT, 0, storageObj->v_array.array);
-					glColorPointer(4, GL_FLOAT, 0, storageObj->c_array.array);
-					glTexCoordPointer(2, GL_FLOAT, 0, storageObj->t_array.array);
-					glDrawArrays(GL_TRIANGLES, 0, storageObj->v_array.used_size);
-				}
-			}
+		oglState.setBlendMode(cmd.blendMode);
+		if (cmd.atlas) {
+			oglState.enableTexturing();
+			oglState.bindAtlas(cmd.atlas);
+			
+			glVertexPointer(2, GL_FLOAT, stride, base + offsetof(TVertex, pos));
+			glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(TVertex, col));
+			glTexCoordPointer(2, GL_FLOAT, stride, base + offsetof(TVertex, tex));
 		}
+		else {
+			oglState.disableTexturing();
+			
+			glVertexPointer(2, GL_FLOAT, stride, base + offsetof(CVertex, pos));
+			glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(CVertex, col));
+		}
+		glDrawArrays(GL_TRIANGLES, 0, cmd.n);
 	}
-	
-	// Call compact() every so often
-	if (frameCounter++ == 60*SECONDS_PER_COMPACT) {
-		compactAllLayers();
-		frameCounter = 0;
-	}
+	#ifdef W_VBOS
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	#endif
 	
 	w_dout << "\n";
 }
 
+W::DrawBatch& W::View::batchFor(int layer, BlendMode::T blendMode, TextureAtlas *atlas) {
+	// Find the batch by binary search, or insert it in order
+	DrawBatch b = { DrawBatch::makeKey(layer, blendMode, atlas), blendMode, atlas, NULL, NULL };
+	std::vector<DrawBatch>::iterator it = std::lower_bound(batches.begin(), batches.end(), b);
+	if (it == batches.end() || it->key != b.key) {
+		w_dout << "  batch not found: inserting\n";
+		it = batches.insert(it, b);
+	}
+	return *it;
+}
+
 void W::View::addDrawable(DColouredShape *d) {
 	w_dout << "View::addDrawable(DColouredShape*)\n";
-	w_dout << " getting layer " << d->layer << "\n";
-	Layer &l = layers[d->layer];
-	
-	w_dout << " getting storage object for blend mode " << d->blendMode << "\n";
-	StorageObjForColouredShapes *&storageForBlendMode = l.cGroups[d->blendMode];
+	w_dout << " getting storage object for layer " << d->layer << " and blend mode " << d->blendMode << "\n";
+	StorageObjForColouredShapes *&storageForBlendMode = batchFor(d->layer, d->blendMode, NULL).cObj;
 	if (!storageForBlendMode) {
 		w_dout << "  not found: creating\n";
 		storageForBlendMode = new StorageObjForColouredShapes();
@@ -212,11 +236,8 @@ void W::View::addDrawable(DColouredShape *d) {
 }
 void W::View::addDrawable(DTexturedShape *d) {
 	w_dout << "View::addDrawable(DTexturedShape*)\n";
-	w_dout << " getting layer " << d->layer << "\n";
-	Layer &l = layers[d->layer];
-	
-	w_dout << " getting storage object for blend mode " << d->blendMode << " and atlas " << d->tex->atlas << "\n";
-	StorageObjForTexturedShapes *&storageForBlendModeAndAtlas = l.tGroups[d->blendMode][d->tex->atlas];
+	w_dout << " getting storage object for layer " << d->layer << ", blend mode " << d->blendMode << " and atlas " << d->tex->atlas << "\n";
+	StorageObjForTexturedShapes *&storageForBlendModeAndAtlas = batchFor(d->layer, d->blendMode, d->tex->atlas).tObj;
 	if (!storageForBlendModeAndAtlas) {
 		w_dout << "  not found: creating\n";
 		storageForBlendModeAndAtlas = new StorageObjForTexturedShapes();
@@ -260,7 +281,10 @@ void W::View::removeDrawable(DTexturedShape *d) {
 }
 
 void W::View::compactAllLayers() {
+	W_PROFILE_ZONE("View::compactAllLayers");
 	w_dout << "View::compactAllLayers()\n";
-	for (std::map<int, Layer>::iterator it = layers.begin(); it != layers.end(); ++it)
-		it->second.compact();
+	for (std::vector<DrawBatch>::iterator it = batches.begin(); it < batches.end(); ++it) {
+		if (it->cObj) it->cObj->compact();
+		if (it->tObj) it->tObj->compact();
+	}
 }
@@ -16,8 +16,11 @@
 #include "Colour.h"
 #include "Callback.h"
 #include "Positioner.h"
+#include "Messenger.h"
 
 #include <map>
+#include <stdint.h>
+#include <vector>
 
 #define MR_CURRENCY '$'
 
@@ -29,16 +32,40 @@ namespace W {
 	class DColouredShape;
 	class DTexturedShape;
 	class TextureAtlas;
+	class StorageObj;
 	class StorageObjForColouredShapes;
 	class StorageObjForTexturedShapes;
 	
 	
-	struct Layer {
-		Layer();
-		~Layer();
-		std::map<BlendMode::T, StorageObjForColouredShapes*> cGroups;
-		std::map<BlendMode::T, std::map<TextureAtlas*, StorageObjForTexturedShapes*>> tGroups;
-		void compact();
+	// A batch of triangles to submit, as gathered by View for drawing
+	struct DrawCmd {
+		BlendMode::T blendMode;
+		TextureAtlas *atlas;	// NULL for coloured shapes
+		StorageObj *storageObj;
+		const void *vertices;	// TVertex if textured, otherwise CVertex
+		int n;
+		
+		// With VBOs, vertices are those to upload, to [uploadFrom, uploadFrom + uploadN)
+		// in a buffer of capacity vertices
+		int uploadFrom, uploadN, capacity;
+	};
+	
+	// A View's drawables are kept in batches, each with its own storage
+	// object, for each combination of layer, blend mode & atlas. Batches
+	// are kept sorted by a key packing these together: the order in which
+	// they are drawn.
+	// - Layers are drawn in order, but the order of drawables within a layer
+	//   is unspecified, & may change whenever one is removed: put
+	//   overlapping drawables in different layers to order them.
+	struct DrawBatch {
+		uint64_t key;
+		BlendMode::T blendMode;
+		TextureAtlas *atlas;
+		StorageObjForColouredShapes *cObj;	// One of these is set: cObj if atlas is NULL
+		StorageObjForTexturedShapes *tObj;
+		
+		static uint64_t makeKey(int layer, BlendMode::T, TextureAtlas *);
+		bool operator< (const DrawBatch &b) const { return key < b.key; }
 	};
 
 	
@@ -60,6 +87,8 @@ namespace W {
 		virtual void touchDown(Event) { }
 		
 		void _draw(v2i winSz);
+		void _prepareDraw();			// Pipelined rendering: snapshot the view's storage,
+		void _submitDraw(v2i winSz);	// then draw the snapshot (on the render thread)
 		
 		const iRect& getRct() { return rct; }
 		
@@ -70,7 +99,7 @@ namespace W {
 		void removeDrawable(DTexturedShape *);
 		void compactAllLayers();
 		
-		std::map<int, Layer> layers;
+		ViewSubscriptions *_subs;	// Positional subscriptions to this view: managed by Messenger
 		
 	protected:
 		bool use_positioner;
@@ -81,9 +110,17 @@ namespace W {
 		
 		virtual void updatePosition(v2i winsize) { }	// Override to implement subclass position update behaviours
 		virtual void customOpenGLDrawing() { }
+			// With pipelined rendering, this is called on the render thread,
+			// while the next update runs: it must not read state that update changes
 		
 	private:
-		int frameCounter;
+		std::vector<DrawBatch> batches;	// Sorted by key
+		DrawBatch& batchFor(int layer, BlendMode::T, TextureAtlas *);
+		
+		void gatherDrawCmds(bool snapshot);
+		std::vector<DrawCmd> drawCmds;
+		iRect drawRct;		// rct & _offset as at gatherDrawCmds()
+		v2i drawOffset;
 		
 	};
 	
@@ -34,6 +34,7 @@ namespace W {
 #endif
 
 W::v2i W::windowSize() {
+  if (!wObjs.window) return wObjs.replayer.windowSize;	// Replaying headlessly
   return wObjs.window->getSize();
 }
 
@@ -53,3 +54,70 @@ void W::pushState(W::GameState *s) {
 void W::popState(W::Returny r) {
 	_popState(r);
 }
+
+
+/*** Event coalescing ***/
+
+void W::setEventCoalescing(int flags) {
+	wObjs.coalescer.flags = flags;
+}
+int W::coalescedEventCount() {
+	return wObjs.coalescer.nCoalesced;
+}
+
+
+/*** Input recording & replay ***/
+
+bool W::startRecording(const std::string &filename) {
+	Rand::seed(Rand::getSeed());	// Restart the sequence, so replay can reproduce it
+	return wObjs.recorder.open(filename, Rand::getSeed(), wObjs.window ? wObjs.window->getSize() : v2i());
+}
+void W::stopRecording() {
+	wObjs.recorder.close();
+}
+bool W::loadReplay(const std::string &filename) {
+	if (!wObjs.replayer.open(filename))
+		return false;
+	Rand::seed(wObjs.replayer.randSeed);
+	return true;
+}
+
+
+/*** Update loop timing ***/
+
+void W::setFrameRate(int fps) {
+	if (fps <= 0) {
+		log << "setFrameRate(): fps must be positive\n";
+		return;
+	}
+	wObjs.frameRate = fps;
+	if (wObjs.updateTimer)
+		wObjs.updateTimer->setFrequency(fps);
+}
+void W::setFixedTimestep(int stepsPerSecond, int maxStepsPerUpdate) {
+	wObjs.fixedStepMicroseconds = (stepsPerSecond > 0 ? 1000000 / stepsPerSecond : 0);
+	wObjs.maxStepsPerUpdate = (maxStepsPerUpdate > 0 ? maxStepsPerUpdate : 1);
+	wObjs.accumulatedMicroseconds = 0;
+}
+float W::renderAlpha() {
+	return wObjs.renderAlpha;
+}
+
+
+/*** Virtual clock ***/
+
+void W::setVirtualClock(int tickMicroseconds, bool skipDrawing) {
+	wObjs.virtualTickMicroseconds = (tickMicroseconds > 0 ? tickMicroseconds : 0);
+	wObjs.skipDrawing = skipDrawing;
+}
+
+
+/*** Pipelined rendering ***/
+
+void W::setPipelinedRendering(bool p) {
+	if (wObjs.renderThread) {
+		log << "setPipelinedRendering() called after start() - ignoring\n";
+		return;
+	}
+	wObjs.pipelined = p;
+}
@@ -36,6 +36,8 @@
 #include "NavMap.h"
 #include "Texture.h"
 #include "Timer.h"
+#include "Profiler.h"
+#include "Jobs.h"
 #include "helpers__fileSys.hpp"
 
 
@@ -56,6 +58,76 @@ namespace W {
 	void popState(W::Returny);
 	
 	extern int updateMicroseconds;	
+	
+	// Event coalescing
+	// - Before dispatch, each frame's events are thinned out:
+	//   - MergeMoves: consecutive MouseMove or TouchMoved events for the same
+	//     pointer become one, from the first's prev_pos to the last's pos
+	//   - DropUnchangedMoves: mouse moves to where the mouse already was, and
+	//     touch moves which go nowhere, are dropped. (Note that a stationary
+	//     mouse then no longer produces a MouseMove each frame.)
+	// - Both are on by default.
+	namespace EventCoalescing {
+		enum T {
+			None = 0,
+			MergeMoves = 1,
+			DropUnchangedMoves = 2,
+			All = MergeMoves | DropUnchangedMoves
+		};
+	}
+	void setEventCoalescing(int flags);
+	int coalescedEventCount();	// Events merged or dropped in the last update
+	
+	// Input recording & replay
+	// - startRecording() writes each frame's input events & updateMicroseconds,
+	//   and the Rand seed, to a binary file. Call it after createWindow() but
+	//   before creating your gamestates, as it restarts Rand's sequence.
+	// - loadReplay() reads a recording & reseeds Rand to match. Call it
+	//   instead of createWindow(), then push your gamestate & call start() as
+	//   usual: the recording is run back identically, frame by frame, without
+	//   a window or drawing, and as fast as possible. start() returns when it
+	//   ends. (Or call it after createWindow() to watch it in the window.)
+	bool startRecording(const std::string &filename);
+	void stopRecording();
+	bool loadReplay(const std::string &filename);
+	
+	// Update loop timing
+	// - setFrameRate() sets how many times per second W updates & draws. By
+	//   default this is 40, or the display's refresh rate on iOS. On Linux,
+	//   by default updates run back to back, as fast as possible.
+	// - setFixedTimestep() decouples the simulation from that rate: each
+	//   update, GameState::update() is called once per whole step of elapsed
+	//   time - perhaps several times, perhaps not at all - with
+	//   updateMicroseconds set to the step length. Events are dispatched before
+	//   the first of these steps. If more than maxStepsPerUpdate steps are due,
+	//   the excess time is dropped rather than caught up on.
+	//   Pass 0 to go back to one update of variable length per frame.
+	// - renderAlpha() is how far, as a fraction of a step, real time has got
+	//   beyond the last simulation step. Draw at (prev + (cur - prev) * alpha)
+	//   to animate smoothly. It is 1 without a fixed timestep.
+	void setFrameRate(int fps);
+	void setFixedTimestep(int stepsPerSecond, int maxStepsPerUpdate = 5);
+	float renderAlpha();
+	
+	// Virtual clock
+	// - setVirtualClock() makes each update advance time by a fixed
+	//   tickMicroseconds instead of the real time elapsed, and start() then
+	//   runs updates back to back, as fast as possible, until the last state
+	//   is popped. With skipDrawing, nothing is drawn - so a long game can be
+	//   simulated in seconds.
+	// - Call it before start(). Pass 0 for real time.
+	// - While fast-forwarding, the platform's run loop is not run, so there is
+	//   no window input.
+	void setVirtualClock(int tickMicroseconds, bool skipDrawing = true);
+	
+	// Pipelined rendering
+	// - With setPipelinedRendering(true), each frame is drawn on a render
+	//   thread while the next update runs, rather than after it on the update
+	//   thread. Each update ends by copying the views' drawable data for the
+	//   render thread - so drawables may be changed freely meanwhile.
+	// - Call before start(). All OpenGL calls are then made on the render
+	//   thread: View::customOpenGLDrawing() is called there.
+	void setPipelinedRendering(bool);
 }
 
 #endif
@@ -39,7 +39,8 @@ W::Window::Window(v2i _sz, const std::string _title) :
 {
 	createWindow();
 	setTitle(_title);
-	setUpOpenGL();
+	if (canDraw())
+		setUpOpenGL();
 }
 W::Window::~Window()
 {
@@ -166,6 +167,7 @@ void W::Window::clearOpenGLThreadAffinity() {
 void W::Window::flushBuffer() {
 	[objs->w_window flushBuffer];
 }
+bool W::Window::canDraw() { return true; }
 W::v2i W::Window::getMousePosition() {
 	NSPoint p = [objs->w_window getMousePosition];
 	return v2i((int)p.x, (int)p.y);
@@ -226,6 +228,7 @@ void W::Window::clearOpenGLThreadAffinity() {
 void W::Window::flushBuffer() {
 	[objs->view flushBuffer];
 }
+bool W::Window::canDraw() { return true; }
 void W::Window::setUpForDrawing() {
 	[objs->view bindFramebuffer];
 }
@@ -426,6 +429,7 @@ void W::Window::clearOpenGLThreadAffinity() {
 void W::Window::flushBuffer() {
 	SwapBuffers(objs->deviceContext);
 }
+bool W::Window::canDraw() { return true; }
 W::position W::Window::getMousePosition() {
 	POINT p;
 	GetCursorPos(&p);
@@ -487,6 +491,87 @@ LRESULT CALLBACK W::Window::_WndProc(HWND windowHandle, UINT msg, WPARAM wParam,
 	return DefWindowProc(windowHandle, msg, wParam, lParam);
 }
 
+#pragma mark - Linux implementation
+
+/********************************************/
+/*** Linux-specific Window implementation ***/
+/********************************************/
+
+#elif defined WTARGET_LINUX
+
+#ifdef W_OSMESA
+	#include <GL/osmesa.h>
+#endif
+#include <vector>
+
+struct W::Window::Objs {
+	#ifdef W_OSMESA
+		OSMesaContext context;
+		std::vector<unsigned char> buffer;	// RGBA
+	#endif
+};
+
+void W::Window::createWindow() {
+	if (objs) {
+		W::log << "createWindow() called, but seems already to exist\n";
+		return;
+	}
+	if (sz.a <= 0 || sz.b <= 0)
+		sz = v2i(800, 600);
+	
+	objs = new Objs();
+	
+	#ifdef W_OSMESA
+		objs->context = OSMesaCreateContextExt(OSMESA_RGBA, 0, 0, 0, NULL);
+		if (!objs->context) {
+			closeWindow();
+			throw Exception("Could not create OSMesa context");
+		}
+		objs->buffer.resize(sz.a * sz.b * 4);
+	#endif
+}
+void W::Window::closeWindow() {
+	if (objs) {
+		#ifdef W_OSMESA
+			if (objs->context) OSMesaDestroyContext(objs->context);
+		#endif
+		delete objs;
+		objs = NULL;
+	}
+}
+void W::Window::setTitle(std::string) { }
+void W::Window::setOpenGLThreadAffinity() {
+	#ifdef W_OSMESA
+		if (!OSMesaMakeCurrent(objs->context, &objs->buffer[0], GL_UNSIGNED_BYTE, sz.a, sz.b))
+			throw Exception("Error making the OSMesa context current");
+	#endif
+}
+void W::Window::clearOpenGLThreadAffinity() {
+	#ifdef W_OSMESA
+		OSMesaMakeCurrent(NULL, NULL, GL_UNSIGNED_BYTE, 0, 0);
+	#endif
+}
+void W::Window::flushBuffer() {
+	#ifdef W_OSMESA
+		glFinish();
+	#endif
+}
+bool W::Window::canDraw() {
+	#ifdef W_OSMESA
+		return true;
+	#else
+		return false;
+	#endif
+}
+const unsigned char* W::Window::offscreenPixels() {
+	#ifdef W_OSMESA
+		return &objs->buffer[0];
+	#else
+		return NULL;
+	#endif
+}
+W::v2i W::Window::getMousePosition() { return v2i(); }	// No mouse: not called
+
 #endif
 
 //#include "texture.h"
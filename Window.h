@@ -12,6 +12,11 @@
 
 // Window encapsulates a window on the device, and the View and OpenGL
 // state associated with it.
+// 
+// On Linux, W is headless: the Window is an offscreen buffer. If W is built
+// with W_OSMESA (& linked against libOSMesa), views are rendered into it in
+// software; otherwise drawing is skipped entirely - a null renderer, for
+// running simulations as fast as possible.
 
 #ifndef __W_Window
 #define __W_Window
@@ -43,6 +48,12 @@ namespace W {
 		void setUpViewport();
 		void beginDrawing();	// Prepare to start new drawing cycle
 		void flushBuffer();		// Draw to the screen
+		bool canDraw();			// False if there is no renderer (Linux)
+		
+		#if defined WTARGET_LINUX
+			const unsigned char* offscreenPixels();
+				// The rendered frame: RGBA, bottom row first. NULL if !canDraw().
+		#endif
 		
 		enum Mode { Windowed, FullScreen } mode;
 		
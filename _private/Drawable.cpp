@@ -15,6 +15,8 @@
 #include "StorageObj.h"
 #include "TextureAtlas.h"
 #include "GenericRetro.h"
+#include "DrawingClasses.h"
+#include <vector>
 
 //#define __W_DEBUG
 #include "DebugMacro.h"
@@ -23,7 +25,9 @@
 
 #pragma mark Rect coord fns
 
-void generateRectCoords(W::v2f pos, W::v2f size, float rotation, W::v3f *);
+template <class Vertex>
+void generateRectCoords(W::v2f pos, W::v2f size, float rotation, Vertex *);
+void expandSpriteInstances(const W::SpriteInstance *, int n, W::Texture *, W::TVertex *);
 
 
 /*** Drawable ***/
@@ -37,23 +41,7 @@ W::Drawable::Drawable(View *_v, int _len, int _lay, BlendMode::T _blend) :
 	blendMode(_blend),
 	preceding_free_space(0)
 {
-  v_array = (v3f*) malloc(sizeof(v3f) * _len);
-  c_array = (v4f*) malloc(sizeof(v4f) * _len);
-}
-W::Drawable::~Drawable()
-{
-	free(v_array);
-	free(c_array);
-}
-void W::Drawable::recopyV() {
-  for (int i=0; i < length; ++i) {
-    vptr[i] = v_array[i];
-  }
-}
-void W::Drawable::recopyC() {
-  for (int i=0; i < length; ++i) {
-    cptr[i] = c_array[i];
-  }
+	// Hai Drawable
 }
 
 
@@ -75,40 +63,31 @@ W::DColouredShape::~DColouredShape()
 	view->removeDrawable(this);
 }
 void W::DColouredShape::updateLength(int _len) {
+  // NB: the contents are lost - the caller must rewrite them
   view->removeDrawable(this);
-
   length = _len;
-
-  free(v_array);
-  free(c_array);
-  v_array = (v3f*) malloc(sizeof(v3f) * _len);
-  c_array = (v4f*) malloc(sizeof(v4f) * _len);
-
   view->addDrawable(this);
-  recopyBoth();
 }
 
 void W::DColouredShape::setLayer(int _layer) {
 	if (layer == _layer) return;
-	
-	view->removeDrawable(this);
-	layer = _layer;
-	view->addDrawable(this);
-	
-	recopyBoth();
+	moveTo(_layer, blendMode);
 }
 void W::DColouredShape::setBlendMode(BlendMode::T _mode) {
 	if (blendMode == _mode)  return;
-
+	moveTo(layer, _mode);
+}
+void W::DColouredShape::moveTo(int _layer, BlendMode::T _mode) {
+	// Moving to another storage object: hold onto D's data in the meantime
+	std::vector<CVertex> v(vptr, vptr + length);
+	
 	view->removeDrawable(this);
+	layer = _layer;
 	blendMode = _mode;
 	view->addDrawable(this);
 	
-	recopyBoth();
-}
-void W::DColouredShape::recopyBoth() {
-	recopyV();
-	recopyC();
+	for (int i=0; i < length; ++i)
+		vptr[i] = v[i];
 }
 
 
@@ -121,16 +100,16 @@ W::DTri::DTri(View *_v, const v2f &_p1, const v2f &_p2, const v2f &_p3, const Co
 	setCol(_col);
 }
 void W::DTri::setP123(const v2f &p1, const v2f &p2, const v2f &p3) {
-	v_array[0] = p1;
-	v_array[1] = p2;
-	v_array[2] = p3;
-	recopyV();
+	vptr[0].pos = p1;
+	vptr[1].pos = p2;
+	vptr[2].pos = p3;
+	dirty();
 }
 void W::DTri::setCol(const Colour &c) {
-	c_array[0] = c;
-	c_array[1] = c;
-	c_array[2] = c;
-	recopyC();
+	vptr[0].col = c;
+	vptr[1].col = c;
+	vptr[2].col = c;
+	dirty();
 }
 
 
@@ -143,17 +122,17 @@ W::DRect::DRect(View *_v, const v2f &_pos, const v2f &_sz, const Colour &_col, f
 	setCol(_col);
 }
 void W::DRect::setPosSzRot(const v2f &_pos, const v2f &_sz, float r) {
-	generateRectCoords(_pos, _sz, r, v_array);
-	recopyV();
+	generateRectCoords(_pos, _sz, r, vptr);
+	dirty();
 }
 void W::DRect::setCol(const W::Colour &c) {
-	c_array[0] = c;
-	c_array[1] = c;
-	c_array[2] = c;
-	c_array[3] = c;
-	c_array[4] = c;
-	c_array[5] = c;
-	recopyC();
+	vptr[0].col = c;
+	vptr[1].col = c;
+	vptr[2].col = c;
+	vptr[3].col = c;
+	vptr[4].col = c;
+	vptr[5].col = c;
+	dirty();
 }
 
 
@@ -166,29 +145,29 @@ W::DLine::DLine(View *_v, const v2f &_p1, const v2f &_p2, const v2f &_delta, con
 	setCol(_col);
 }
 void W::DLine::setP1P2Delta(const v2f &p1, const v2f &p2, const v2f &delta) {
-	v_array[0] = p1 - delta;
-	v_array[1] = p2 - delta;
-	v_array[2] = p2 + delta;
-	v_array[3] = v_array[0];
-	v_array[4] = p1 + delta;
-	v_array[5] = v_array[2];
-	recopyV();
+	vptr[0].pos = p1 - delta;
+	vptr[1].pos = p2 - delta;
+	vptr[2].pos = p2 + delta;
+	vptr[3].pos = vptr[0].pos;
+	vptr[4].pos = p1 + delta;
+	vptr[5].pos = vptr[2].pos;
+	dirty();
 }
 void W::DLine::setCol(const Colour &c) {
-	c_array[0] = c;
-	c_array[1] = c;
-	c_array[2] = c;
-	c_array[3] = c;
-	c_array[4] = c;
-	c_array[5] = c;
-	recopyC();
+	vptr[0].col = c;
+	vptr[1].col = c;
+	vptr[2].col = c;
+	vptr[3].col = c;
+	vptr[4].col = c;
+	vptr[5].col = c;
+	dirty();
 }
 
 
 #pragma mark - DCircle
 #define CIRCLE_NPOINTS 10
 
-void getCircleCoords(W::v2f pos, float r, W::v3f *v_array);
+void getCircleCoords(W::v2f pos, float r, W::CVertex *);
 
 W::DCircle::DCircle(View *_v, v2f _center, float _r, W::Colour _col, int layer, BlendMode::T blendMode) :
 	DColouredShape(_v, CIRCLE_NPOINTS*3, layer, blendMode)
@@ -197,14 +176,14 @@ W::DCircle::DCircle(View *_v, v2f _center, float _r, W::Colour _col, int layer,
 	setCol(_col);
 }
 void W::DCircle::setPosRadius(W::v2f _pos, float _r) {
-	getCircleCoords(_pos, _r, v_array);
-	recopyV();
+	getCircleCoords(_pos, _r, vptr);
+	dirty();
 }
 void W::DCircle::setCol(W::Colour _c) {
 	for (int i=0; i < CIRCLE_NPOINTS*3; ++i) {
-		c_array[i] = _c;
+		vptr[i].col = _c;
 	}
-	recopyC();
+	dirty();
 }
 
 
@@ -220,8 +199,6 @@ W::DTexturedShape::DTexturedShape(View *_v, Texture *_t, int _len, int _lay, Ble
 	prev(NULL),
 	next(NULL)
 {
-	t_array = (v2f*) malloc(sizeof(v2f) * length);
-	
 	view->addDrawable(this);
 	tex->incrementUsageCount();
 	tex->atlas->addDrawable(this);
@@ -231,35 +208,31 @@ W::DTexturedShape::~DTexturedShape()
 	view->removeDrawable(this);
 	tex->decrementUsageCount();
 	tex->atlas->remDrawable(this);
-	
-	free(t_array);
 }
-void W::DTexturedShape::setLayer(int _layer) {
-	if (layer == _layer) return;
-
+void W::DTexturedShape::updateLength(int _len) {
+	// NB: as for DColouredShape, the contents are lost
 	view->removeDrawable(this);
-	layer = _layer;
+	length = _len;
 	view->addDrawable(this);
-	
-	recopyAll();
+}
+void W::DTexturedShape::setLayer(int _layer) {
+	if (layer == _layer) return;
+	moveTo(_layer, blendMode);
 }
 void W::DTexturedShape::setBlendMode(BlendMode::T _mode) {
 	if (blendMode == _mode) return;
+	moveTo(layer, _mode);
+}
+void W::DTexturedShape::moveTo(int _layer, BlendMode::T _mode) {
+	std::vector<TVertex> v(vptr, vptr + length);
 	
 	view->removeDrawable(this);
+	layer = _layer;
 	blendMode = _mode;
 	view->addDrawable(this);
 	
-	recopyAll();
-}
-void W::DTexturedShape::recopyT() {
 	for (int i=0; i < length; ++i)
-		tptr[i] = t_array[i];
-}
-void W::DTexturedShape::recopyAll() {
-	recopyV();
-	recopyC();
-	recopyT();
+		vptr[i] = v[i];
 }
 
 
@@ -271,49 +244,75 @@ W::DSprite::DSprite(View *_v, Texture *_t, const v2f &_p, const v2f &_sc, float
 	setPosScaleRot(_p, _sc, _rot);
 	setOpac(_opac);
 	
-	regenAndCopyTexCoords();
+	regenTexCoords();
 }
 void W::DSprite::setPosScaleRot(const v2f &p, const v2f &sc, float r) {
 	const v2i &tSz = tex->getSize();
-	generateRectCoords(p + sc * 0.5, v2f(tSz.a * sc.a, tSz.b * sc.b) - sc, r, v_array);
+	generateRectCoords(p + sc * 0.5, v2f(tSz.a * sc.a, tSz.b * sc.b) - sc, r, vptr);
 	#ifdef __W_DEBUG
 		std::cout << "DSprite::setPosScaleRot():\n";
 		for (int i=0; i < length; ++i)
-			std::cout << " " << v_array[i].str() << "\n";
+			std::cout << " " << vptr[i].pos.str() << "\n";
 	#endif
-	recopyV();
+	dirty();
 }
 void W::DSprite::setOpac(float _opac) {
-	for (int i=0; i < length; ++i) {
-		c_array[i].a = c_array[i].b = c_array[i].c = 1;
-		c_array[i].d = _opac;
-	}
-	recopyC();
+	for (int i=0; i < length; ++i)
+		vptr[i].col = Colour(1, 1, 1, _opac);
+	dirty();
 }
-void W::DSprite::regenAndCopyTexCoords() {
+void W::DSprite::regenTexCoords() {
 	float
 		tA = tex->floatCoordA(),
 		tB = tex->floatCoordB(),
 		tC = tex->floatCoordC(),
 		tD = tex->floatCoordD();
 	W::v2f
-		&tc1 = t_array[0],
-		&tc2 = t_array[1],
-		&tc3 = t_array[2],
-		&tc4 = t_array[3],
-		&tc5 = t_array[4],
-		&tc6 = t_array[5];
+		&tc1 = vptr[0].tex,
+		&tc2 = vptr[1].tex,
+		&tc3 = vptr[2].tex,
+		&tc4 = vptr[3].tex,
+		&tc5 = vptr[4].tex,
+		&tc6 = vptr[5].tex;
 	tc1.a = tA, tc1.b = tB;
 	tc2.a = tA, tc2.b = tD;
 	tc3.a = tC, tc3.b = tD;
 	tc4.a = tA, tc4.b = tB;
 	tc5.a = tC, tc5.b = tB;
 	tc6.a = tC, tc6.b = tD;
-	
-	recopyT();
+	dirty();
 }
 
 
+#pragma mark - DSpriteBatch
+
+W::DSpriteBatch::DSpriteBatch(View *_v, Texture *_t, const std::vector<SpriteInstance> &_instances, int _lay, BlendMode::T _blend) :
+	DTexturedShape(_v, _t, 0, _lay, _blend),
+	instances(_instances)
+{
+	// Hai DSpriteBatch
+}
+void W::DSpriteBatch::update(int from, int n) {
+	int nInstances = (int) instances.size();
+	if (length != nInstances * 6) {
+		updateLength(nInstances * 6);
+		from = 0, n = nInstances;
+	}
+	if (from < 0 || from + n > nInstances)
+		throw Exception("SpriteBatch::update(): range is outside of the batch's instances");
+	expand(from, n);
+}
+void W::DSpriteBatch::regenTexCoords() {
+	int n = length / 6;
+	if (n > (int) instances.size()) n = (int) instances.size();
+	expand(0, n);
+}
+void W::DSpriteBatch::expand(int from, int n) {
+	if (n <= 0) return;
+	expandSpriteInstances(&instances[from], n, tex, vptr + from*6);
+	storageObj->markDirty(index + from*6, n*6);
+}
+
 #pragma mark - DRetroText
 
 int widthForChar(char c) {
@@ -354,9 +353,9 @@ void W::DRetroText::setPosTxtAlignmentCol(v2f pos, std::string txt, TextAlign::T
   updateVertices(pos, txt);
 
   for (int i=0; i < length; ++i) {
-    c_array[i] = col;
+    vptr[i].col = col;
   }
-  recopyC();
+  dirty();
 }
 void W::DRetroText::updateVertices(W::v2f pos, std::string txt) {
   v2f letterPos = pos;
@@ -367,13 +366,11 @@ void W::DRetroText::updateVertices(W::v2f pos, std::string txt) {
     std::vector<fRect> rects_for_letter = GenericRetro[c];
     for (auto r : rects_for_letter) {
       v2f p = letterPos + r.position;
-      generateRectCoords(p, r.size, 0, v_array+geomOffset);
+      generateRectCoords(p, r.size, 0, vptr+geomOffset);
       geomOffset += 6;
     }
     letterPos.a += widthForChar(c);
   }
-
-  recopyV();
 }
 
 
@@ -386,16 +383,15 @@ void W::DRetroText::updateVertices(W::v2f pos, std::string txt) {
 #define RAD2DEG (180.0/M_PI)
 #define DEG2RAD (M_PI/180.0)
 
-void generateRectCoords(W::v2f pos, W::v2f sz, float rotation, W::v3f *v_array) {
-	W::v3f
-		&v1 = v_array[0],
-		&v2 = v_array[1],
-		&v3 = v_array[2],
-		&v4 = v_array[3],
-		&v5 = v_array[4],
-		&v6 = v_array[5];
-	
-	v1.c = v2.c = v3.c = v4.c = v5.c = v6.c = 0;
+template <class Vertex>
+void generateRectCoords(W::v2f pos, W::v2f sz, float rotation, Vertex *v) {
+	W::v2f
+		&v1 = v[0].pos,
+		&v2 = v[1].pos,
+		&v3 = v[2].pos,
+		&v4 = v[3].pos,
+		&v5 = v[4].pos,
+		&v6 = v[5].pos;
 	
 	v1.a = 0,       v1.b = 0;
 	v2.a = 0,       v2.b = sz.b;
@@ -411,7 +407,7 @@ void generateRectCoords(W::v2f pos, W::v2f sz, float rotation, W::v3f *v_array)
 		float cosR = cos(rot), sinR = sin(rot);
 		int centreX = 0.5*sz.a, centreY = 0.5*sz.b;
 		
-		W::v3f v1r, v2r, v3r, v5r;
+		W::v2f v1r, v2r, v3r, v5r;
 		
 		v1r.a = (v1.a-centreX)*cosR - (v1.b-centreY)*sinR + centreX;
 		v2r.a = (v2.a-centreX)*cosR - (v2.b-centreY)*sinR + centreX;
@@ -469,14 +465,82 @@ void generateUnitCircleCoords() {
 	}
 }
 
-void getCircleCoords(W::v2f pos, float r, W::v3f *v_array) {
+void getCircleCoords(W::v2f pos, float r, W::CVertex *v) {
 	if (v_unit_circle == 0) {
 		generateUnitCircleCoords();
 	}
 	
 	for (int i=0; i < CIRCLE_NPOINTS*3; ++i) {
-		v_array[i] = v_unit_circle[i] * r;
-		v_array[i].a += pos.a;
-		v_array[i].b += pos.b;
+		v[i].pos.a = v_unit_circle[i].a * r + pos.a;
+		v[i].pos.b = v_unit_circle[i].b * r + pos.b;
+	}
+}
+
+
+#pragma mark - expandSpriteInstances
+
+// Write the 6 vertices of each of n sprite instances. Sprites are laid
+// out as by DSprite, and all share the texture, so its atlas coords are
+// looked up once, and sin & cos only recomputed when rotation changes.
+
+void expandSpriteInstances(const W::SpriteInstance *inst, int n, W::Texture *tex, W::TVertex *v) {
+	const W::v2i &tSz = tex->getSize();
+	float
+		tA = tex->floatCoordA(),
+		tB = tex->floatCoordB(),
+		tC = tex->floatCoordC(),
+		tD = tex->floatCoordD(),
+		texelSz = 1.0f / tex->atlas->width();
+	
+	float prevRot = 0, cosR = 1, sinR = 0;
+	
+	for (const W::SpriteInstance *end = inst + n; inst < end; ++inst, v += 6) {
+		// Frame size & texcoords
+		const W::iRect &f = inst->frame;
+		bool wholeTex = (f.size.a <= 0 || f.size.b <= 0);
+		float
+			fw = wholeTex ? tSz.a : f.size.a,
+			fh = wholeTex ? tSz.b : f.size.b,
+			A = tA, B = tB, C = tC, D = tD;
+		if (!wholeTex) {
+			A += f.position.a * texelSz;
+			B += f.position.b * texelSz;
+			C -= (tSz.a - f.position.a - f.size.a) * texelSz;
+			D -= (tSz.b - f.position.b - f.size.b) * texelSz;
+		}
+		
+		// Half-axes of the rect, rotated about its centre
+		if (inst->rot != prevRot) {
+			float rot = inst->rot * DEG2RAD;
+			cosR = cos(rot), sinR = sin(rot);
+			prevRot = inst->rot;
+		}
+		const W::v2f &sc = inst->scale;
+		float
+			hw = 0.5f * (fw * sc.a - sc.a),
+			hh = 0.5f * (fh * sc.b - sc.b),
+			cx = inst->pos.a + 0.5f * sc.a + hw,
+			cy = inst->pos.b + 0.5f * sc.b + hh,
+			ua = hw * cosR, ub = hw * sinR,
+			va = -hh * sinR, vb = hh * cosR;
+		
+		W::rgba8 col;
+		col = W::Colour(1, 1, 1, inst->opac);
+		
+		v[0].pos.a = cx - ua - va, v[0].pos.b = cy - ub - vb;
+		v[1].pos.a = cx - ua + va, v[1].pos.b = cy - ub + vb;
+		v[2].pos.a = cx + ua + va, v[2].pos.b = cy + ub + vb;
+		v[4].pos.a = cx + ua - va, v[4].pos.b = cy + ub - vb;
+		v[3].pos = v[0].pos;
+		v[5].pos = v[2].pos;
+		
+		v[0].tex.a = A, v[0].tex.b = B;
+		v[1].tex.a = A, v[1].tex.b = D;
+		v[2].tex.a = C, v[2].tex.b = D;
+		v[3].tex.a = A, v[3].tex.b = B;
+		v[4].tex.a = C, v[4].tex.b = B;
+		v[5].tex.a = C, v[5].tex.b = D;
+		
+		v[0].col = v[1].col = v[2].col = v[3].col = v[4].col = v[5].col = col;
 	}
 }
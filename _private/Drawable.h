@@ -16,6 +16,8 @@
 #define __W__Drawable
 
 #include "types.h"
+#include "StorageObj.h"
+#include <vector>
 
 namespace W {
 
@@ -23,11 +25,14 @@ namespace W {
   class Texture;
   class StorageObjForColouredShapes;
   class StorageObjForTexturedShapes;
+  struct SpriteInstance;
+
+  // Ds are drawn in order of layer. Within a layer, order is unspecified:
+  // removing a D may move another into its slot (see StorageObj.h).
 
   class Drawable {
   public:
     Drawable(View *, int length, int layer, BlendMode::T);
-    ~Drawable();
 
     int length;
     int index;
@@ -38,13 +43,9 @@ namespace W {
 
     View *view;
 
-    v3f *vptr, *v_array;
-    v4f *cptr, *c_array;
-    // xptr: ptr to chunk of managed storage
-    // x_array: local copy (modify this then recopy)
-
-    void recopyV();
-    void recopyC();
+    // Subclasses' vptr: ptr to chunk of managed storage. Ds write their
+    // data straight into it. It moves if the storage object is resized or
+    // compacted, so must not be held onto.
   };
 
 
@@ -60,11 +61,14 @@ namespace W {
     void setLayer(int);
     void setBlendMode(BlendMode::T);
 
-    void recopyBoth();
-
     StorageObjForColouredShapes *storageObj;
+    CVertex *vptr;
+    void dirty() { storageObj->markDirty(index, length); }	// Call after writing to vptr
 
     DColouredShape *prev, *next;
+
+  private:
+    void moveTo(int layer, BlendMode::T);	// Move to a different storage object
   };
 
 
@@ -110,23 +114,29 @@ namespace W {
   class DTexturedShape : public Drawable {
   public:
     DTexturedShape(View *, Texture *, int _len, int _lay, BlendMode::T _bMode);
-    ~DTexturedShape();
+    virtual ~DTexturedShape();
     // NB: the constructor only adds D to the view, setting D's
     // properties. It doesn't copy anything in - this is the subclass's job.
     // (Except for texcoords, which the subclass won't generally touch.)
 
+    void updateLength(int);
+
     void setLayer(int);
     void setBlendMode(BlendMode::T);
 
     StorageObjForTexturedShapes *storageObj;
     Texture *tex;
 
-    v2f *tptr, *t_array;
+    TVertex *vptr;
+    void dirty() { storageObj->markDirty(index, length); }
 
-    void recopyT();
-    void recopyAll();
+    virtual void regenTexCoords() { }
+    // Called when the atlas is resized, changing the texture's coords
 
     DTexturedShape *prev, *next;
+
+  private:
+    void moveTo(int layer, BlendMode::T);
   };
 
 
@@ -137,8 +147,24 @@ namespace W {
     void setPosScaleRot(const v2f &pos, const v2f &sc, float rot);
     void setOpac(float);
 
-    void regenAndCopyTexCoords();
-    // Generate texcoords from tex in local array & call recopyT()
+    void regenTexCoords();
+    // Generate texcoords from tex
+  };
+
+
+  class DSpriteBatch : public DTexturedShape {
+  public:
+    DSpriteBatch(View *, Texture *, const std::vector<SpriteInstance> &, int layer, BlendMode::T);
+
+    void update(int from, int n);
+    // Expand instances [from, from+n) into vertices. If the number
+    // of instances has changed, all are expanded.
+
+    void regenTexCoords();
+
+  private:
+    const std::vector<SpriteInstance> &instances;
+    void expand(int from, int n);
   };
 
 
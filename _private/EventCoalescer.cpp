@@ -0,0 +1,101 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * =====================
+ *  EventCoalescer.cpp
+ * =====================
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+#include "EventCoalescer.h"
+
+W::EventCoalescer::EventCoalescer() :
+	flags(EventCoalescing::All),
+	nCoalesced(0),
+	haveLastMousePos(false)
+{
+	// hai
+}
+
+void W::EventCoalescer::process(std::vector<Event> &evs) {
+	using namespace EventType;
+	
+	nCoalesced = 0;
+	if (flags == EventCoalescing::None)
+		return;
+	
+	int n = (int) evs.size(), out = 0;
+	bool merging = flags & EventCoalescing::MergeMoves;
+	bool dropping = flags & EventCoalescing::DropUnchangedMoves;
+	
+	// 1. Merge runs of moves. Each merged move takes the place of the first in its run.
+	int pendingMouseMove = -1;
+	pendingTouchMoves.clear();
+	
+	for (int i=0; i < n; ++i) {
+		const Event &ev = evs[i];
+		
+		if (merging && ev.type == MouseMove) {
+			if (pendingMouseMove >= 0) {
+				evs[pendingMouseMove].pos = ev.pos;
+				continue;
+			}
+			pendingMouseMove = out;
+		}
+		else if (merging && ev.type == TouchMoved) {
+			std::vector<PendingMove>::iterator it;
+			for (it = pendingTouchMoves.begin(); it < pendingTouchMoves.end(); ++it)
+				if (it->touchID == ev.touchID) break;
+			if (it < pendingTouchMoves.end()) {
+				evs[it->i].pos = ev.pos;
+				continue;
+			}
+			PendingMove pm = { ev.touchID, out };
+			pendingTouchMoves.push_back(pm);
+		}
+		else if (ev.type >= LMouseUp && ev.type <= RMouseDown) {
+			pendingMouseMove = -1;
+		}
+		else if (ev.type >= TouchDown && ev.type <= TouchCancelled) {
+			for (std::vector<PendingMove>::iterator it = pendingTouchMoves.begin(); it < pendingTouchMoves.end(); ++it)
+				if (it->touchID == ev.touchID) {
+					pendingTouchMoves.erase(it);
+					break;
+				}
+		}
+		
+		if (out != i) evs[out] = ev;
+		++out;
+	}
+	
+	// 2. Drop moves which go nowhere
+	if (dropping) {
+		int kept = 0;
+		for (int i=0; i < out; ++i) {
+			const Event &ev = evs[i];
+			if (ev.type == MouseMove) {
+				bool unchanged = haveLastMousePos && ev.pos == lastMousePos;
+				lastMousePos = ev.pos, haveLastMousePos = true;
+				if (unchanged) continue;
+			}
+			else if (ev.type == TouchMoved && ev.pos == ev.prev_pos) {
+				continue;
+			}
+			if (kept != i) evs[kept] = ev;
+			++kept;
+		}
+		out = kept;
+	}
+	else {
+		// Still track the mouse, so dropping works if turned on later
+		for (int i=0; i < out; ++i)
+			if (evs[i].type == MouseMove)
+				lastMousePos = evs[i].pos, haveLastMousePos = true;
+	}
+	
+	nCoalesced = n - out;
+	evs.erase(evs.begin() + out, evs.end());
+}
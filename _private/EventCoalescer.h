@@ -0,0 +1,48 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ===================
+ *  EventCoalescer.h
+ * ===================
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+// EventCoalescer thins out a frame's events before they are dispatched.
+// - Consecutive moves of the mouse, or of a touch, are merged into one,
+//   which goes from the first move's prev_pos to the last move's pos.
+//   Any other event involving a pointer ends its run of moves.
+// - Moves that go nowhere are dropped.
+// See W::setEventCoalescing().
+
+#ifndef __W__EventCoalescer
+#define __W__EventCoalescer
+
+#include "W.h"
+#include <vector>
+
+namespace W {
+	
+	class EventCoalescer {
+	public:
+		EventCoalescer();
+		
+		void process(std::vector<Event> &);
+			// Coalesces in place, preserving the order of what remains
+		
+		int flags;		// EventCoalescing::T flags
+		int nCoalesced;	// Merged or dropped in the last call to process()
+		
+	private:
+		struct PendingMove { int touchID; int i; };
+		std::vector<PendingMove> pendingTouchMoves;
+		
+		v2f lastMousePos;
+		bool haveLastMousePos;
+	};
+	
+}
+
+#endif
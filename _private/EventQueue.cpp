@@ -0,0 +1,68 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ==================
+ *  EventQueue.cpp
+ * ==================
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+#include "EventQueue.h"
+
+static_assert((W::EventQueue::Capacity & (W::EventQueue::Capacity - 1)) == 0, "EventQueue::Capacity must be a power of 2");
+
+#define SLOT(i) slots[(i) & (Capacity - 1)]
+
+W::EventQueue::EventQueue() :
+	head(0),
+	tail(0)
+{
+	// A slot at index i is free for the producer at position i when seq == i,
+	// and ready for the consumer at position i when seq == i + 1
+	for (unsigned int i=0; i < Capacity; ++i)
+		slots[i].seq.store(i, std::memory_order_relaxed);
+}
+
+bool W::EventQueue::push(const Event &ev) {
+	unsigned int pos = head.load(std::memory_order_relaxed);
+	for (;;) {
+		Slot &slot = SLOT(pos);
+		unsigned int seq = slot.seq.load(std::memory_order_acquire);
+		int diff = (int) (seq - pos);
+		
+		if (diff == 0) {
+			// Slot is free: claim position, or retry if another producer got there first
+			if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				slot.ev = ev;
+				slot.seq.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0) {
+			// Slot still holds an event from the previous lap: full
+			return false;
+		}
+		else {
+			// Another producer has claimed pos
+			pos = head.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+int W::EventQueue::drain(std::vector<Event> &out) {
+	unsigned int end = head.load(std::memory_order_acquire);
+	int n = 0;
+	
+	while (tail != end) {
+		Slot &slot = SLOT(tail);
+		if (slot.seq.load(std::memory_order_acquire) != tail + 1)
+			break;	// Claimed, but the producer is mid-write: leave for next time
+		out.push_back(slot.ev);
+		slot.seq.store(tail + Capacity, std::memory_order_release);
+		++tail, ++n;
+	}
+	return n;
+}
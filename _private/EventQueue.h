@@ -0,0 +1,58 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ================
+ *  EventQueue.h
+ * ================
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+// EventQueue is W's event queue: a bounded, lock-free ring buffer with
+// many producers (input callbacks, worker threads) and one consumer (the
+// update loop).
+// - Each slot has a sequence number, which tells a producer whether the
+//   slot is free, and the consumer whether it has been filled.
+// - Producers never wait on the consumer, or on each other beyond a
+//   compare-and-swap. If the queue is full, push() fails.
+
+#ifndef __W__EventQueue
+#define __W__EventQueue
+
+#include "Event.h"
+#include <atomic>
+#include <vector>
+
+namespace W {
+	
+	class EventQueue {
+	public:
+		enum { Capacity = 2048 };	// Must be a power of 2
+		
+		EventQueue();
+		
+		bool push(const Event &);
+			// Any thread. Returns false if full.
+		
+		int drain(std::vector<Event> &);
+			// Consumer only. Appends the events queued as of now, and returns
+			// how many. Events pushed meanwhile are left for the next drain.
+		
+	private:
+		struct Slot {
+			Slot() : ev(EventType::Unknown) { }
+			std::atomic<unsigned int> seq;
+			Event ev;
+		};
+		Slot slots[Capacity];
+		
+		// Keep producers' & consumer's positions on separate cache lines
+		alignas(64) std::atomic<unsigned int> head;	// Next position to push to
+		alignas(64) unsigned int tail;				// Next position to pop from
+	};
+	
+}
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ======================
+ *  InputRecording.cpp
+ * ======================
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+#include "InputRecording.h"
+#include "Log.h"
+#include <cstdint>
+
+#define REC_MAGIC   0x43455257	// "WREC"
+#define REC_VERSION 1
+
+namespace {
+	template <class X> void put(std::ofstream &f, X x) {
+		f.write((const char*) &x, sizeof(X));
+	}
+	template <class X> bool get(std::ifstream &f, X &x) {
+		return (bool) f.read((char*) &x, sizeof(X));
+	}
+}
+
+
+#pragma mark - InputRecorder
+
+bool W::InputRecorder::open(const std::string &filename, unsigned int randSeed, v2i windowSize) {
+	close();
+	f.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!f.is_open()) {
+		W::log << "InputRecorder: couldn't open '" << filename << "' for writing\n";
+		return false;
+	}
+	put<uint32_t>(f, REC_MAGIC);
+	put<uint32_t>(f, REC_VERSION);
+	put<uint32_t>(f, randSeed);
+	put<int32_t>(f, windowSize.a);
+	put<int32_t>(f, windowSize.b);
+	return true;
+}
+
+void W::InputRecorder::writeFrame(int updateMicroseconds, const std::vector<Event> &evs, int first) {
+	if (!f.is_open()) return;
+	put<int32_t>(f, updateMicroseconds);
+	put<uint32_t>(f, (uint32_t) (evs.size() - first));
+	for (std::vector<Event>::const_iterator it = evs.begin() + first; it < evs.end(); ++it) {
+		const Event &ev = *it;
+		put<int32_t>(f, ev.type);
+		put<int32_t>(f, ev.key);
+		put<float>(f, ev.pos.a);
+		put<float>(f, ev.pos.b);
+		put<float>(f, ev.prev_pos.a);
+		put<float>(f, ev.prev_pos.b);
+		put<float>(f, ev.x);
+		put<int32_t>(f, ev.touchID);
+		if (ev.payload == Event::NoPayload)
+			put<int32_t>(f, -1);
+		else {
+			const std::string &str = ev.payloadString();
+			put<int32_t>(f, (int32_t) str.size());
+			f.write(str.data(), str.size());
+		}
+	}
+}
+
+void W::InputRecorder::close() {
+	if (f.is_open()) f.close();
+}
+
+
+#pragma mark - InputReplayer
+
+bool W::InputReplayer::open(const std::string &filename) {
+	f.open(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!f.is_open()) {
+		W::log << "InputReplayer: couldn't open '" << filename << "'\n";
+		return false;
+	}
+	uint32_t magic = 0, version = 0, seed = 0;
+	int32_t w = 0, h = 0;
+	if (!get(f, magic) || magic != REC_MAGIC || !get(f, version) || version != REC_VERSION
+		|| !get(f, seed) || !get(f, w) || !get(f, h)) {
+		W::log << "InputReplayer: '" << filename << "' is not a W input recording (or is from another version)\n";
+		f.close();
+		return false;
+	}
+	randSeed = seed;
+	windowSize = v2i(w, h);
+	nFrames = 0;
+	return true;
+}
+
+bool W::InputReplayer::readFrame(int &updateMicroseconds, std::vector<Event> &evs) {
+	int32_t usecs;
+	uint32_t n;
+	if (!f.is_open() || !get(f, usecs) || !get(f, n))
+		return false;
+	
+	std::string str;
+	for (uint32_t i=0; i < n; ++i) {
+		int32_t type, key, touchID, len;
+		float pa, pb, ppa, ppb, x;
+		if (!(get(f, type) && get(f, key) && get(f, pa) && get(f, pb) && get(f, ppa) && get(f, ppb)
+			  && get(f, x) && get(f, touchID) && get(f, len)))
+			return false;
+		
+		Event ev(type);
+		ev.key = (KeyCode::T) key;
+		ev.pos = v2f(pa, pb);
+		ev.prev_pos = v2f(ppa, ppb);
+		ev.x = x;
+		ev.touchID = touchID;
+		if (len >= 0) {
+			str.resize(len);
+			if (len > 0 && !f.read(&str[0], len)) return false;
+			ev.setPayload(str);
+		}
+		evs.push_back(ev);
+	}
+	updateMicroseconds = usecs;
+	++nFrames;
+	return true;
+}
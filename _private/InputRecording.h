@@ -0,0 +1,65 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ====================
+ *  InputRecording.h
+ * ====================
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+// InputRecorder writes the input to each frame - its events, as drained
+// from the event queue, & updateMicroseconds - to a binary file, which
+// InputReplayer reads back.
+// - Format: a header (magic, version, Rand seed, window size), then per
+//   frame: updateMicroseconds, event count, and the events. Values are
+//   written in native byte order.
+// - Event payloads are interned per-process, so are written as strings
+
+#ifndef __W__InputRecording
+#define __W__InputRecording
+
+#include "Event.h"
+#include <fstream>
+#include <vector>
+
+namespace W {
+	
+	class InputRecorder {
+	public:
+		InputRecorder() { }
+		~InputRecorder() { close(); }
+		
+		bool open(const std::string &filename, unsigned int randSeed, v2i windowSize);
+		void writeFrame(int updateMicroseconds, const std::vector<Event> &, int first = 0);
+			// Writes the events from index 'first' onwards
+		void close();
+		bool isOpen() { return f.is_open(); }
+		
+	private:
+		std::ofstream f;
+	};
+	
+	class InputReplayer {
+	public:
+		InputReplayer() : randSeed(0), nFrames(0) { }
+		
+		bool open(const std::string &filename);
+		bool readFrame(int &updateMicroseconds, std::vector<Event> &);
+			// Appends the frame's events. Returns false at the end of the recording.
+		void close() { f.close(); }
+		bool isOpen() { return f.is_open(); }
+		
+		unsigned int randSeed;
+		v2i windowSize;
+		int nFrames;	// Frames read so far
+		
+	private:
+		std::ifstream f;
+	};
+	
+}
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * =================
+ *  RectIndex.cpp
+ * =================
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+#include "RectIndex.h"
+#include "Messenger.h"
+#include <cmath>
+
+//#define __W_DEBUG
+#include "DebugMacro.h"
+
+#define RI_MIN_CELL_SIZE 32.0
+#define RI_MAX_CELLS_PER_SIDE 64
+
+W::RectIndex::RectIndex() :
+	dirty(true),
+	validatedEpoch(0),
+	cellSize(RI_MIN_CELL_SIZE),
+	nx(0), ny(0)
+{
+	// hai
+}
+
+const std::vector<int>* W::RectIndex::candidatesAt(const std::vector<cbAndRect> &subs, v2f p, unsigned int epoch) {
+	if (dirty || epoch != validatedEpoch)
+		refresh(subs, epoch);
+	
+	int i = (int) floorf((p.a - origin.a) / cellSize);
+	int j = (int) floorf((p.b - origin.b) / cellSize);
+	if (i < 0 || j < 0 || i >= nx || j >= ny)
+		return NULL;
+	
+	const std::vector<int> &cell = cells[j*nx + i];
+	return cell.empty() ? NULL : &cell;
+}
+
+void W::RectIndex::refresh(const std::vector<cbAndRect> &subs, unsigned int epoch) {
+	validatedEpoch = epoch;
+	
+	// Rebuild if subscriptions have changed, or any rect has moved
+	bool needsRebuild = dirty || cached.size() != subs.size();
+	for (int i=0, n=(int)subs.size(); i < n && !needsRebuild; ++i) {
+		const fRect *r = subs[i].rct;
+		if (r && (r->position != cached[i].position || r->size != cached[i].size))
+			needsRebuild = true;
+	}
+	
+	if (needsRebuild)
+		rebuild(subs);
+	dirty = false;
+}
+
+void W::RectIndex::rebuild(const std::vector<cbAndRect> &subs) {
+	w_dout << "RectIndex::rebuild() (" << this << ", " << subs.size() << " rects)\n";
+	
+	int n = (int) subs.size();
+	cached.resize(n);
+	cells.clear();
+	nx = ny = 0;
+	if (n == 0)
+		return;
+	
+	// Get bounding box of live subscriptions (removed ones have no rect)
+	int first = 0;
+	while (first < n && !subs[first].rct) cached[first++] = fRect();
+	if (first == n)
+		return;
+	
+	v2f mn = subs[first].rct->position, mx = mn;
+	for (int i=first; i < n; ++i) {
+		if (!subs[i].rct) {
+			cached[i] = fRect();
+			continue;
+		}
+		const fRect &r = *subs[i].rct;
+		cached[i] = r;
+		if (r.position.a < mn.a) mn.a = r.position.a;
+		if (r.position.b < mn.b) mn.b = r.position.b;
+		if (r.position.a + r.size.a > mx.a) mx.a = r.position.a + r.size.a;
+		if (r.position.b + r.size.b > mx.b) mx.b = r.position.b + r.size.b;
+	}
+	
+	// Choose a cell size keeping the grid within RI_MAX_CELLS_PER_SIDE
+	float extent = (mx.a - mn.a > mx.b - mn.b ? mx.a - mn.a : mx.b - mn.b);
+	cellSize = RI_MIN_CELL_SIZE;
+	if (extent / cellSize > RI_MAX_CELLS_PER_SIDE)
+		cellSize = extent / RI_MAX_CELLS_PER_SIDE;
+	
+	origin = mn;
+	nx = (int) ceilf((mx.a - mn.a) / cellSize) + 1;
+	ny = (int) ceilf((mx.b - mn.b) / cellSize) + 1;
+	cells.resize(nx * ny);
+	
+	// Bin each rect into the cells it covers. Indices are added in
+	// ascending order, so cells preserve subscription order.
+	for (int k=0; k < n; ++k) {
+		const fRect &r = cached[k];
+		if (r.size.a <= 0 || r.size.b <= 0)
+			continue;
+		int i0 = (int) floorf((r.position.a - origin.a) / cellSize);
+		int j0 = (int) floorf((r.position.b - origin.b) / cellSize);
+		int i1 = (int) floorf((r.position.a + r.size.a - origin.a) / cellSize);
+		int j1 = (int) floorf((r.position.b + r.size.b - origin.b) / cellSize);
+		if (i1 >= nx) i1 = nx - 1;
+		if (j1 >= ny) j1 = ny - 1;
+		for (int j=j0; j <= j1; ++j)
+			for (int i=i0; i <= i1; ++i)
+				cells[j*nx + i].push_back(k);
+	}
+}
@@ -0,0 +1,58 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ===============
+ *  RectIndex.h
+ * ===============
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+// RectIndex is a uniform grid over a View's positional subscription rects,
+// so hit-testing an event only tests the rects in the cell beneath it.
+// - Subscribers' rects are held by pointer & may move, so the index keeps
+//   a copy of each, and checks them whenever the epoch passed in changes,
+//   rebuilding if needed. The Messenger bumps it each frame & after each
+//   event it delivers, as a callback may move a rect mid-frame.
+
+#ifndef __W__RectIndex
+#define __W__RectIndex
+
+#include "types.h"
+#include <vector>
+
+namespace W {
+	
+	struct cbAndRect;
+	
+	class RectIndex {
+	public:
+		RectIndex();
+		
+		void invalidate() { dirty = true; }
+			// Call when subscriptions are added or removed
+		
+		const std::vector<int>* candidatesAt(const std::vector<cbAndRect> &, v2f p, unsigned int epoch);
+			// Indices of subscriptions whose rects may contain p, in
+			// ascending order - or NULL if none
+		
+	private:
+		void refresh(const std::vector<cbAndRect> &, unsigned int epoch);
+		void rebuild(const std::vector<cbAndRect> &);
+		
+		bool dirty;
+		unsigned int validatedEpoch;
+		
+		std::vector<fRect> cached;	// Rects as of last rebuild
+		
+		v2f origin;
+		float cellSize;
+		int nx, ny;
+		std::vector<std::vector<int>> cells;
+	};
+	
+}
+
+#endif
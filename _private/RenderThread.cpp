@@ -0,0 +1,94 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ====================
+ *  RenderThread.cpp
+ * ====================
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+#include "RenderThread.h"
+#include "Window.h"
+#include "View.h"
+#include "TextureAtlas.h"
+#include "WInt_Texture.h"
+#include "Profiler.h"
+#include "W_internal.h"
+
+//#define __W_DEBUG
+#include "DebugMacro.h"
+
+W::RenderThread::RenderThread(Window *_window) :
+	window(_window),
+	pending(false),
+	uploading(false),
+	quit(false)
+{
+	frame.setUpViewport = true;
+	thread = std::thread(&RenderThread::run, this);
+}
+W::RenderThread::~RenderThread()
+{
+	waitIdle();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	cond.notify_all();
+	thread.join();
+}
+
+void W::RenderThread::waitIdle() {
+	std::unique_lock<std::mutex> lock(mutex);
+	cond.wait(lock, [this]() { return !pending; });
+}
+void W::RenderThread::kick() {
+	std::unique_lock<std::mutex> lock(mutex);
+	pending = true;
+	uploading = !frame.atlases.empty() || !frame.textures.empty();
+	cond.notify_all();
+	cond.wait(lock, [this]() { return !uploading; });
+}
+
+void W::RenderThread::run() {
+	w_dout << "RenderThread::run()\n";
+	window->setOpenGLThreadAffinity();
+	
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cond.wait(lock, [this]() { return pending || quit; });
+			if (quit) break;
+		}
+		W_PROFILE_ZONE("RenderThread frame");
+		
+		// Upload atlases & textures, then let the update thread continue
+		for (std::vector<TextureAtlas*>::iterator it = frame.atlases.begin(); it < frame.atlases.end(); ++it)
+			(*it)->upload();
+		for (std::vector<WInt_Texture*>::iterator it = frame.textures.begin(); it < frame.textures.end(); ++it)
+			(*it)->_upload();
+		if (!frame.atlases.empty() || !frame.textures.empty()) {
+			std::lock_guard<std::mutex> lock(mutex);
+			uploading = false;
+			cond.notify_all();
+		}
+		
+		oglState.deleteVBOs(frame.deletedVBOs);
+		oglState.deleteTextures(frame.deletedTextures);
+		if (frame.setUpViewport)
+			window->setUpViewport();
+		window->beginDrawing();
+		for (std::vector<View*>::iterator it = frame.views.begin(); it < frame.views.end(); ++it)
+			(*it)->_submitDraw(frame.winSize);
+		window->flushBuffer();
+		
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = false;
+		cond.notify_all();
+	}
+	
+	window->clearOpenGLThreadAffinity();
+}
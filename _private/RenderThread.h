@@ -0,0 +1,74 @@
+/*
+ * W - a tiny 2D game development library
+ *
+ * ==================
+ *  RenderThread.h
+ * ==================
+ *
+ * Copyright (C) 2012 - Ben Hallstein - http://ben.am
+ * Published under the MIT license: http://opensource.org/licenses/MIT
+ *
+ */
+
+// RenderThread draws frames for pipelined rendering, so that drawing frame
+// N overlaps updating frame N+1.
+// - The render thread owns the GL context while it runs: GL is not touched
+//   on any other thread.
+// - Each update, once the previous frame is drawn (waitIdle), the update
+//   thread fills in `frame` - the views' _prepareDraw() snapshots their
+//   storage - and calls kick().
+// - kick() returns once any modified atlases & textures have been uploaded,
+//   so the update thread can then modify or delete them again. GL names
+//   of deleted ones are handed over in `frame` too.
+
+#ifndef __W__RenderThread
+#define __W__RenderThread
+
+#include "types.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WInt_Texture;
+
+namespace W {
+	
+	class Window;
+	class View;
+	class TextureAtlas;
+	
+	class RenderThread {
+	public:
+		RenderThread(Window *);
+		~RenderThread();	// Waits for the current frame, then stops
+		
+		void waitIdle();
+		void kick();
+		
+		struct Frame {
+			std::vector<View*> views;
+			std::vector<TextureAtlas*> atlases;	// To upload before drawing
+			std::vector<WInt_Texture*> textures;	// ~
+			std::vector<unsigned int> deletedVBOs;
+			std::vector<unsigned int> deletedTextures;
+			v2i winSize;
+			bool setUpViewport;
+		};
+		Frame frame;	// Only touch while idle
+	
+	private:
+		void run();
+		
+		Window *window;
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable cond;
+		bool pending;		// A frame has been kicked & not yet drawn
+		bool uploading;		// ...and its atlases & textures are not yet uploaded
+		bool quit;
+	};
+	
+}
+
+#endif
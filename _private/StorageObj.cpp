@@ -25,14 +25,27 @@
 /*** StorageObj ***/
 /******************/
 
+W::rgba8& W::rgba8::operator= (const Colour &c) {
+	r = (unsigned char) (c.r <= 0 ? 0 : c.r >= 1 ? 255 : c.r * 255 + 0.5);
+	g = (unsigned char) (c.g <= 0 ? 0 : c.g >= 1 ? 255 : c.g * 255 + 0.5);
+	b = (unsigned char) (c.b <= 0 ? 0 : c.b >= 1 ? 255 : c.b * 255 + 0.5);
+	a = (unsigned char) (c.a <= 0 ? 0 : c.a >= 1 ? 255 : c.a * 255 + 0.5);
+	return *this;
+}
+
+std::vector<unsigned int> W::StorageObj::_deletedVBOs;
+
 W::StorageObj::StorageObj() :
-	v_array(DATA_ARRAY_INITIAL_SIZE)
+	dirtyFrom(0),
+	dirtyTo(0),
+	vbo(0),
+	vboCapacity(0)
 {
 	// hi
 }
 W::StorageObj::~StorageObj()
 {
-	// bai
+	if (vbo) _deletedVBOs.push_back(vbo);
 }
 
 
@@ -43,7 +56,8 @@ W::StorageObj::~StorageObj()
 /***********************************/
 
 W::StorageObjForColouredShapes::StorageObjForColouredShapes() :
-	c_array(DATA_ARRAY_INITIAL_SIZE),
+	v_array(DATA_ARRAY_INITIAL_SIZE),
+	freeSpace(0),
 	firstD(NULL),
 	lastD(NULL)
 {
@@ -59,24 +73,16 @@ void W::StorageObjForColouredShapes::addDrawable(DColouredShape *d) {
 	// Expand arrays if necessary
 	while(v_array.used_size + d->length > v_array.capacity) expandArrays();
 	
-	if (v_array.used_size != c_array.used_size || v_array.capacity != c_array.capacity) {
-		std::string msg = "Error: StorageObjForColouredShapes v_array & c_array differ in size\n";
-		w_dout << "   " << msg;
-		log << msg;
-		return;
-	}
-		
 	// Set D's index and ptrs
 	int &i = d->index = v_array.used_size;
 	d->vptr = v_array.array + i;
-	d->cptr = c_array.array + i;
 	d->storageObj = this;
 	
 	w_dout << "   D (len: " << d->length << ") added to storage object, index: " << d->index << ", vptr: " << d->vptr << "\n";
 	
 	// Increase array used_size by D.length
 	v_array.used_size += d->length;
-	c_array.used_size += d->length;
+	markDirty(i, d->length);
 	
 	// Insert in chain
 	if (!firstD)
@@ -92,51 +98,89 @@ void W::StorageObjForColouredShapes::addDrawable(DColouredShape *d) {
 void W::StorageObjForColouredShapes::removeDrawable(DColouredShape *d) {
 	w_dout << " StorageObjForColouredShapes::removeDrawable()\n";
 	
-	// Make vertices degenerate
-	w_dout << "  making vertices degenerate: ";
-	for (int i=0; i < d->length; ++i) {
-		w_dout << i+1 << " ";
-		v3f &v = d->vptr[i];
-		v.a = v.b = 0;
-	}
-	w_dout << "\n";
-	
 	int &l = d->length;
-	// If D was last obj, just decrease arrays' used_size by D.length + D.preceding_removed
-	if (!d->next) {
-		v_array.used_size -= l + d->preceding_free_space;
-		c_array.used_size -= l + d->preceding_free_space;
-		w_dout << "  D was last obj in chain: decreased used_size to " << v_array.used_size << "\n";
+	DColouredShape *t = lastD;
+	
+	// If the last D is the same length, move it into D's place, so no hole is left
+	if (t != d && t->length == l) {
+		w_dout << "  moving last D " << t << " into D's place, index: " << d->index << "\n";
+		for (int i=0; i < l; ++i)
+			v_array.array[d->index + i] = v_array.array[t->index + i];
+		markDirty(d->index, l);
+		int freed = l + t->preceding_free_space;
+		freeSpace -= t->preceding_free_space;
+		
+		// Unlink T from the end of the chain, then put it in D's place
+		lastD = t->prev;
+		lastD->next = NULL;
+		
+		t->prev = d->prev;
+		t->next = d->next;
+		if (!t->prev) firstD = t;
+		else t->prev->next = t;
+		if (!t->next) lastD = t;
+		else t->next->prev = t;
+		
+		t->preceding_free_space = d->preceding_free_space;
+		t->index = d->index;
+		t->vptr = v_array.array + t->index;
+		
+		v_array.used_size -= freed;
+		w_dout << "  decreased used_size to " << v_array.used_size << "\n";
 	}
 	
-	// Otherwise, increment D.next's preceding_free_space
-	else
-		if (d->next) {
+	else {
+		// Make vertices degenerate
+		w_dout << "  making vertices degenerate: ";
+		for (int i=0; i < d->length; ++i) {
+			w_dout << i+1 << " ";
+			v2f &v = d->vptr[i].pos;
+			v.a = v.b = 0;
+		}
+		markDirty(d->index, l);
+		w_dout << "\n";
+		
+		// If D was last obj, just decrease arrays' used_size by D.length + D.preceding_removed
+		if (!d->next) {
+			v_array.used_size -= l + d->preceding_free_space;
+			freeSpace -= d->preceding_free_space;
+			w_dout << "  D was last obj in chain: decreased used_size to " << v_array.used_size << "\n";
+		}
+		
+		// Otherwise, increment D.next's preceding_free_space
+		else {
 			d->next->preceding_free_space += l + d->preceding_free_space;
+			freeSpace += l;
 			w_dout << "  found a following D': set its preceding_free_space to " << d->next->preceding_free_space << "\n";
 		}
+		
+		// Unlink from chain
+		w_dout << "  unlinking D from chain\n";
+		if (!d->prev) firstD = d->next;		// If D was first in chain, set obj.firstD to D.next
+		else d->prev->next = d->next;		// Otherwise set D.prev's next to D.next
+		
+		if (!d->next) lastD = d->prev;		// If DObj was last in chain, set obj.lastD to D.prev
+		else d->next->prev = d->prev;		// Otherwise, set D.next's prev to D.prev
+	}
 	
-	// Unlink from chain
-	w_dout << "  unlinking D from chain\n";
-	if (!d->prev) firstD = d->next;		// If D was first in chain, set obj.firstD to D.next
-	else d->prev->next = d->next;		// Otherwise set D.prev's next to D.next
+	d->next = NULL;
+	d->prev = NULL;
+	d->preceding_free_space = 0;
 	
-	if (!d->next) lastD = d->prev;		// If DObj was last in chain, set obj.lastD to D.prev
-	else d->next->prev = d->prev;		// Otherwise, set D.next's prev to D.prev
-
-  d->next = NULL;
-  d->prev = NULL;
-  d->preceding_free_space = 0;
+	// Holes are left only between Ds of differing lengths: compact once they
+	// take up more than half the used space, so the cost per removal stays constant
+	if (freeSpace > v_array.used_size / 2)
+		compact();
+	else
+		contractArrays();
 }
 void W::StorageObjForColouredShapes::expandArrays() {
 	v_array.expand();
-	c_array.expand();
 	updateDrawablePtrs();
 }
 void W::StorageObjForColouredShapes::contractArrays() {
 	while (v_array.capacity > DATA_ARRAY_INITIAL_SIZE && v_array.used_size < v_array.capacity * COMPACTION_THRESHOLD) {
 		v_array.contract();
-		c_array.contract();
 		updateDrawablePtrs();
 	}
 }
@@ -152,20 +196,18 @@ void W::StorageObjForColouredShapes::compact() {
 		w_dout << "  moving D " << d << " back by " << n << "\n";
 		
 		if (runningCopyBackTotal) {
-      for (int i=0; i < d->length; ++i) {
+      for (int i=0; i < d->length; ++i)
 				v_array.array[d->index + i - n] = v_array.array[d->index + i];
-				c_array.array[d->index + i - n] = c_array.array[d->index + i];
-      }
       d->index -= n;
 			d->vptr -= n;
-			d->cptr -= n;
 			w_dout << "   array_index: " << d->index << ", vptr: " << d->vptr << "\n";
 		}
 		
 		d->preceding_free_space = 0;
 	}
 	v_array.used_size -= runningCopyBackTotal;
-	c_array.used_size -= runningCopyBackTotal;
+	freeSpace = 0;
+	markDirty(0, v_array.used_size);
 	w_dout << "  used size now: " << v_array.used_size << "\n";
 	
 	// Contract arrays if used_size has decreased sufficiently
@@ -177,20 +219,23 @@ void W::StorageObjForColouredShapes::updateDrawablePtrs() {
 	for (DColouredShape *d = firstD; d; d = d->next) {
 		w_dout << "  D " << d << " vptr: " << d->vptr << " -> ";
 		d->vptr = v_array.array + d->index;
-		d->cptr = c_array.array + d->index;
 		w_dout << d->vptr << "\n";
 	}
+	markDirty(0, v_array.used_size);	// The arrays have been reallocated
+}
+void W::StorageObjForColouredShapes::_snapshot(int from, int to) {
+	// assign() reuses the vector's capacity, so is just a copy once warmed up
+	v_snapshot.assign(v_array.array + from, v_array.array + to);
 }
 void W::StorageObjForColouredShapes::print() {
 	w_dout << " StorageObjForColouredShapes::print()\n";
 	w_dout << "  storageObj: " << this << "\n";
 	w_dout << "  used size: " << v_array.used_size << "\n";
 	w_dout << "  vertices: \n";
-	for (int i=0; i < v_array.used_size; ++i)
-		w_dout << "   " << v_array.array[i].str() << "\n";
-	w_dout << "  colours: \n";
-	for (int i=0; i < c_array.used_size; ++i)
-		w_dout << "   " << c_array.array[i].str() << "\n";
+	for (int i=0; i < v_array.used_size; ++i) {
+		CVertex &v = v_array.array[i];
+		w_dout << "   " << v.pos.str() << " rgba " << (int) v.col.r << "," << (int) v.col.g << "," << (int) v.col.b << "," << (int) v.col.a << "\n";
+	}
 }
 
 
@@ -201,8 +246,8 @@ void W::StorageObjForColouredShapes::print() {
 /***********************************/
 
 W::StorageObjForTexturedShapes::StorageObjForTexturedShapes() :
-	c_array(DATA_ARRAY_INITIAL_SIZE),
-	t_array(DATA_ARRAY_INITIAL_SIZE),
+	v_array(DATA_ARRAY_INITIAL_SIZE),
+	freeSpace(0),
 	firstD(NULL),
 	lastD(NULL)
 {
@@ -218,32 +263,16 @@ void W::StorageObjForTexturedShapes::addDrawable(DTexturedShape *d) {
 	// Expand arrays if necessary
 	while(v_array.used_size + d->length > v_array.capacity) expandArrays();
 	
-	if (v_array.used_size != c_array.used_size || v_array.capacity != c_array.capacity) {
-		std::string s("Error: StorageObjForTexturedShapes v_array & c_array differ in size\n");
-		w_dout << "   " << s;
-		log << s;
-		return;
-	}
-	if (v_array.used_size != t_array.used_size || v_array.capacity != t_array.capacity) {
-		std::string s("Error: StorageObjForTexturedShapes v_array & t_array differ in size\n");
-		w_dout << "   " << s;
-		log << s;
-		return;
-	}
-
 	// Set D's index and ptrs
 	int &i = d->index = v_array.used_size;
 	d->vptr = v_array.array + i;
-	d->cptr = c_array.array + i;
-	d->tptr = t_array.array + i;
 	d->storageObj = this;
 	
 	w_dout << "   D (len: " << d->length << ") added to storage object, index: " << d->index << ", vptr: " << d->vptr << "\n";
 	
 	// Increase array used_size by D.length
 	v_array.used_size += d->length;
-	c_array.used_size += d->length;
-	t_array.used_size += d->length;
+	markDirty(i, d->length);
 	
 	// Insert in chain
 	if (!firstD)
@@ -259,52 +288,89 @@ void W::StorageObjForTexturedShapes::addDrawable(DTexturedShape *d) {
 void W::StorageObjForTexturedShapes::removeDrawable(DTexturedShape *d) {
 	w_dout << "StorageObjForTexturedShapes::removeDrawable()\n";
 	
-	// Make vertices degenerate
-	w_dout << "  making vertices degenerate: ";
-	for (int i=0; i < d->length; ++i) {
-		w_dout << i+1 << " ";
-		v3f &v = d->vptr[i];
-		v.a = v.b = 0;
-	}
-	w_dout << "\n";
-	
 	int &l = d->length;
-	// If D was last obj, just decrease arrays' used_size by D.length + D.preceding_removed
-	if (!d->next) {
-		v_array.used_size -= l + d->preceding_free_space;
-		c_array.used_size -= l + d->preceding_free_space;
-		t_array.used_size -= l + d->preceding_free_space;
-		w_dout << "  D was last obj in chain: decreased used_size to " << v_array.used_size << "\n";
+	DTexturedShape *t = lastD;
+	
+	// If the last D is the same length, move it into D's place, so no hole is left
+	if (t != d && t->length == l) {
+		w_dout << "  moving last D " << t << " into D's place, index: " << d->index << "\n";
+		for (int i=0; i < l; ++i)
+			v_array.array[d->index + i] = v_array.array[t->index + i];
+		markDirty(d->index, l);
+		int freed = l + t->preceding_free_space;
+		freeSpace -= t->preceding_free_space;
+		
+		// Unlink T from the end of the chain, then put it in D's place
+		lastD = t->prev;
+		lastD->next = NULL;
+		
+		t->prev = d->prev;
+		t->next = d->next;
+		if (!t->prev) firstD = t;
+		else t->prev->next = t;
+		if (!t->next) lastD = t;
+		else t->next->prev = t;
+		
+		t->preceding_free_space = d->preceding_free_space;
+		t->index = d->index;
+		t->vptr = v_array.array + t->index;
+		
+		v_array.used_size -= freed;
+		w_dout << "  decreased used_size to " << v_array.used_size << "\n";
 	}
 	
-	// Otherwise, increment D.next's preceding_free_space
-	else
-		if (d->next) {
+	else {
+		// Make vertices degenerate
+		w_dout << "  making vertices degenerate: ";
+		for (int i=0; i < d->length; ++i) {
+			w_dout << i+1 << " ";
+			v2f &v = d->vptr[i].pos;
+			v.a = v.b = 0;
+		}
+		markDirty(d->index, l);
+		w_dout << "\n";
+		
+		// If D was last obj, just decrease arrays' used_size by D.length + D.preceding_removed
+		if (!d->next) {
+			v_array.used_size -= l + d->preceding_free_space;
+			freeSpace -= d->preceding_free_space;
+			w_dout << "  D was last obj in chain: decreased used_size to " << v_array.used_size << "\n";
+		}
+		
+		// Otherwise, increment D.next's preceding_free_space
+		else {
 			d->next->preceding_free_space += l + d->preceding_free_space;
+			freeSpace += l;
 			w_dout << "  found a following D': set its preceding_free_space to " << d->next->preceding_free_space << "\n";
 		}
+		
+		// Unlink from chain
+		w_dout << "  unlinking D from chain\n";
+		if (!d->prev) firstD = d->next;		// If D was first in chain, set obj.firstD to D.next
+		else d->prev->next = d->next;		// Otherwise set D.prev's next to D.next
+		
+		if (!d->next) lastD = d->prev;		// If DObj was last in chain, set obj.lastD to D.prev
+		else d->next->prev = d->prev;		// Otherwise, set D.next's prev to D.prev
+	}
 	
-	// Unlink from chain
-	w_dout << "  unlinking D from chain\n";
-	if (!d->prev) firstD = d->next;		// If D was first in chain, set obj.firstD to D.next
-	else d->prev->next = d->next;		// Otherwise set D.prev's next to D.next
-	
-	if (!d->next) lastD = d->prev;		// If DObj was last in chain, set obj.lastD to D.prev
-	else d->next->prev = d->prev;		// Otherwise, set D.next's prev to D.prev
+	d->next = NULL;
+	d->prev = NULL;
+	d->preceding_free_space = 0;
 	
+	// As for coloured shapes, compact only when holes take up over half the space
+	if (freeSpace > v_array.used_size / 2)
+		compact();
+	else
+		contractArrays();
 }
 
 void W::StorageObjForTexturedShapes::expandArrays() {
 	v_array.expand();
-	c_array.expand();
-	t_array.expand();
 	updateDrawablePtrs();
 }
 void W::StorageObjForTexturedShapes::contractArrays() {
 	while (v_array.capacity > DATA_ARRAY_INITIAL_SIZE && v_array.used_size < v_array.capacity * COMPACTION_THRESHOLD) {
 		v_array.contract();
-		c_array.contract();
-		t_array.contract();
 		updateDrawablePtrs();
 	}
 }
@@ -321,23 +387,18 @@ void W::StorageObjForTexturedShapes::compact() {
 		w_dout << "  moving D " << d << " back by " << n << "\n";
 		
 		if (runningCopyBackTotal) {
-	        for (int i=0; i < d->length; ++i) {
+	        for (int i=0; i < d->length; ++i)
 				v_array.array[d->index + i - n] = v_array.array[d->index + i];
-				c_array.array[d->index + i - n] = c_array.array[d->index + i];
-				t_array.array[d->index + i - n] = t_array.array[d->index + i];
-	        }
 	        d->index -= n;
 			d->vptr -= n;
-			d->cptr -= n;
-			d->tptr -= n;
 			w_dout << "   array_index: " << d->index << ", vptr: " << d->vptr << "\n";
 		}
 		
 		d->preceding_free_space = 0;
 	}
 	v_array.used_size -= runningCopyBackTotal;
-	c_array.used_size -= runningCopyBackTotal;
-	t_array.used_size -= runningCopyBackTotal;
+	freeSpace = 0;
+	markDirty(0, v_array.used_size);
 	w_dout << "  used size now: " << v_array.used_size << "\n";
 	
 	// Contract arrays if used_size has decreased sufficiently
@@ -349,22 +410,20 @@ void W::StorageObjForTexturedShapes::updateDrawablePtrs() {
 	for (DTexturedShape *d = firstD; d; d = d->next) {
 		w_dout << "  D " << d << " vptr: " << d->vptr << " -> ";
 		d->vptr = v_array.array + d->index;
-		d->cptr = c_array.array + d->index;
-		d->tptr = t_array.array + d->index;
 		w_dout << d->vptr << "\n";
 	}
+	markDirty(0, v_array.used_size);	// The arrays have been reallocated
+}
+void W::StorageObjForTexturedShapes::_snapshot(int from, int to) {
+	v_snapshot.assign(v_array.array + from, v_array.array + to);
 }
 void W::StorageObjForTexturedShapes::print() {
 	w_dout << " StorageObjForTexturedShapes::print()\n";
 	w_dout << "  storageObj: " << this << "\n";
 	w_dout << "  used size: " << v_array.used_size << "\n";
 	w_dout << "  vertices: \n";
-	for (int i=0; i < v_array.used_size; ++i)
-		w_dout << "   " << v_array.array[i].str() << "\n";
-	w_dout << "  colours: \n";
-	for (int i=0; i < c_array.used_size; ++i)
-		w_dout << "   " << c_array.array[i].str() << "\n";
-	w_dout << "  texcoords: \n";
-	for (int i=0; i < t_array.used_size; ++i)
-		w_dout << "   " << t_array.array[i].str() << "\n";
+	for (int i=0; i < v_array.used_size; ++i) {
+		TVertex &v = v_array.array[i];
+		w_dout << "   " << v.pos.str() << " rgba " << (int) v.col.r << "," << (int) v.col.g << "," << (int) v.col.b << "," << (int) v.col.a << " tex " << v.tex.str() << "\n";
+	}
 }
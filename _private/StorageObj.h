@@ -11,25 +11,64 @@
  */
 
 // StorageObjs manage backing arrays for use by Drawables
+// - Drawables are added at the end of the arrays.
+// - When one is removed, the last is moved into its place if the same
+//   length, keeping the arrays dense. Otherwise, a hole is left, which
+//   is reclaimed once it reaches the end, or by compact() if the holes grow
+//   to more than half the used space.
+// - So the order of Ds in the arrays - the order they are drawn in - is
+//   not preserved: see View.h
 
 #ifndef __W__StorageObj
 #define __W__StorageObj
 
 #include "types.h"
+#include "Colour.h"
 #include "TemplatedArrayThingy.h"
+#include <vector>
 
 namespace W {
 
 	class DColouredShape;
 	class DTexturedShape;
 	
+	// Vertices are stored interleaved: drawn with a single stride
+	struct rgba8 {
+		unsigned char r, g, b, a;
+		rgba8& operator= (const Colour &);
+	};
+	struct CVertex {
+		v2f pos;
+		rgba8 col;
+	};
+	struct TVertex {
+		v2f pos;
+		rgba8 col;
+		v2f tex;
+	};
+	
+	// Where vertex buffer objects are available, each StorageObj has one,
+	// kept on the GPU. Changes to the arrays are tracked as a dirty range
+	// of vertices, and only that range is uploaded when next drawn.
 	class StorageObj {
 	public:
 		StorageObj();
-		~StorageObj();
-		TemplatedArrayThingy<v3f> v_array;
+		virtual ~StorageObj();
 		
 		virtual void print() = 0;
+		
+		void markDirty(int from, int n) {
+			if (dirtyFrom >= dirtyTo) dirtyFrom = from, dirtyTo = from + n;
+			else {
+				if (from < dirtyFrom) dirtyFrom = from;
+				if (from + n > dirtyTo) dirtyTo = from + n;
+			}
+		}
+		int dirtyFrom, dirtyTo;
+		
+		unsigned int vbo;		// Created, sized & deleted on the GL thread
+		int vboCapacity;
+		static std::vector<unsigned int> _deletedVBOs;	// To delete on the GL thread
 	};
 	
 	
@@ -37,7 +76,7 @@ namespace W {
 	public:
 		StorageObjForColouredShapes();
 		~StorageObjForColouredShapes();
-		TemplatedArrayThingy<v4f> c_array;
+		TemplatedArrayThingy<CVertex> v_array;
 		
 		void addDrawable(DColouredShape *);
 		void removeDrawable(DColouredShape *);
@@ -48,10 +87,15 @@ namespace W {
 		
 		void print();
 		
+		// Pipelined rendering: a copy of part of the array, for the render thread
+		void _snapshot(int from, int to);
+		std::vector<CVertex> v_snapshot;
+		
 	private:
 		void expandArrays();		// Double array size & update D ptrs
 		void contractArrays();		// Halve array size & ~
 		void updateDrawablePtrs();
+		int freeSpace;				// Total length of the holes between Ds
 		DColouredShape *firstD, *lastD;
 	};
 	
@@ -60,8 +104,7 @@ namespace W {
 	public:
 		StorageObjForTexturedShapes();
 		~StorageObjForTexturedShapes();
-		TemplatedArrayThingy<v4f> c_array;
-		TemplatedArrayThingy<v2f> t_array;
+		TemplatedArrayThingy<TVertex> v_array;
 		
 		void addDrawable(DTexturedShape *);
 		void removeDrawable(DTexturedShape *);
@@ -72,10 +115,15 @@ namespace W {
 		
 		void print();
 		
+		// Pipelined rendering: a copy of part of the array, for the render thread
+		void _snapshot(int from, int to);
+		std::vector<TVertex> v_snapshot;
+		
 	private:
 		void expandArrays();		// Double array size & update D ptrs
 		void contractArrays();		// Halve array size & ~
 		void updateDrawablePtrs();
+		int freeSpace;
 		DTexturedShape *firstD, *lastD;
 	};
 
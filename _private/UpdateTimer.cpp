@@ -18,7 +18,7 @@
 /*** UpdateTimer: common implementation ***/
 /******************************************/
 
-W::UpdateTimer::UpdateTimer(vdfncb _fp) : objs(NULL), running(false), fp(_fp)
+W::UpdateTimer::UpdateTimer(vdfncb _fp) : objs(NULL), running(false), frequency(0), fp(_fp)
 {
 	createTimer();
 }
@@ -26,6 +26,16 @@ W::UpdateTimer::~UpdateTimer()
 {
 	destroyTimer();
 }
+void W::UpdateTimer::setFrequency(int hz) {
+	frequency = hz;
+	#ifndef WTARGET_LINUX
+		if (running) {
+			stop();
+			start();
+		}
+	#endif
+		// (On Linux the loop picks up the new frequency itself)
+}
 
 
 /********************************************************/
@@ -59,8 +69,14 @@ void W::UpdateTimer::destroyTimer() {
 		objs = NULL;
 	}
 }
-void W::UpdateTimer::start() { [objs->timer start]; }
-void W::UpdateTimer::stop() { [objs->timer stop]; }
+void W::UpdateTimer::start() {
+	[objs->timer startWithFrequency:frequency];
+	running = true;
+}
+void W::UpdateTimer::stop() {
+	[objs->timer stop];
+	running = false;
+}
 
 
 /************************************************/
@@ -106,13 +122,74 @@ void W::UpdateTimer::destroyTimer() {
 }
 void W::UpdateTimer::start() {
 	// Create mmt
-	MMRESULT mmr = timeSetEvent(20, 40, &_mmtCallback, NULL, TIME_PERIODIC);
+	UINT ms = (frequency ? 1000 / frequency : 20);
+	MMRESULT mmr = timeSetEvent(ms ? ms : 1, 40, &_mmtCallback, NULL, TIME_PERIODIC);
 	if (mmr == NULL)
 		throw Exception("UpdateTimer: Error starting multimedia timer");
 	objs->timer = mmr;
+	running = true;
 }
 void W::UpdateTimer::stop() {
 	timeKillEvent(objs->timer);
+	running = false;
+}
+
+
+/**************************************************/
+/*** UpdateTimer: Linux-specific implementation ***/
+/**************************************************/
+
+#elif defined WTARGET_LINUX
+#pragma mark - Linux impl
+
+#include "Timer.h"
+#include <time.h>
+
+// There is no run loop to attach to: start() runs the loop itself, on the
+// calling thread, until stop() is called from within an update.
+// - With no frequency set, updates run back to back
+// - Otherwise, updates are paced to the frequency. If one overruns, the
+//   schedule is reset, rather than bunching updates to catch up.
+
+struct W::UpdateTimer::Objs { };
+
+void W::UpdateTimer::createTimer() {
+	if (objs) {
+		W::log << "UpdateTimer: createTimer() called but 'objs' already exists";
+		return;
+	}
+	objs = new Objs();
+}
+void W::UpdateTimer::destroyTimer() {
+	if (objs) {
+		delete objs;
+		objs = NULL;
+	}
+}
+void W::UpdateTimer::start() {
+	running = true;
+	Timer t;
+	unsigned long long next = 0;
+	
+	while (running) {
+		(*fp)();
+		if (!frequency || !running)
+			continue;
+		
+		unsigned long long period = 1000000000ULL / frequency, now = t.getNanoseconds();
+		next += period;
+		if (next <= now) {
+			if (now - next > period) next = now;
+			continue;
+		}
+		struct timespec ts;
+		ts.tv_sec = (time_t) ((next - now) / 1000000000ULL);
+		ts.tv_nsec = (long) ((next - now) % 1000000000ULL);
+		nanosleep(&ts, NULL);
+	}
+}
+void W::UpdateTimer::stop() {
+	running = false;
 }
 
 #endif
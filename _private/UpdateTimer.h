@@ -27,11 +27,13 @@ namespace W {
 		
 		void start();
 		void stop();
+		void setFrequency(int hz);	// Takes effect immediately if running
 	private:
 		void createTimer();
 		void destroyTimer();
 		
 		bool running;
+		int frequency;	// 0: the platform default
 		
 		struct Objs;
 		Objs *objs;
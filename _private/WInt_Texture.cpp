@@ -14,32 +14,50 @@
 #include "WInt_Image.h"
 #include "../types.h"
 #include "../Log.h"
+#include "W_internal.h"
 
 #include "oglInclude.h"
 #include "SOIL.h"
 
+std::set<WInt_Texture*> WInt_Texture::_pendingUploads;
+
 WInt_Texture::WInt_Texture(WInt_Image *image) :
-	glTexID(0)
+	width(0),
+	height(0),
+	glTexID(0),
+	pendingChannels(0)
 {
-	obtainOGLTexID();
 	if (image) upload(image);
 }
 
 WInt_Texture::~WInt_Texture()
 {
-	glDeleteTextures(1, &glTexID);
+	// The render thread may be drawing with the texture
+	W::_waitForRenderThread();
+	_pendingUploads.erase(this);
+	if (glTexID)
+		W::oglState._deletedTextures.push_back(glTexID);
 }
 
 void WInt_Texture::upload(WInt_Image *image) {
 	width = image->width;
 	height = image->height;
 	
-	SOIL_create_OGL_texture(image->data,
-							image->width,
-							image->height,
-							image->nChannels,
+	pendingData.assign(image->data, image->data + width * height * image->nChannels);
+	pendingChannels = image->nChannels;
+	_pendingUploads.insert(this);
+}
+
+void WInt_Texture::_upload() {
+	obtainOGLTexID();
+	SOIL_create_OGL_texture(&pendingData[0],
+							width,
+							height,
+							pendingChannels,
 							glTexID,
 							0);
+	std::vector<unsigned char>().swap(pendingData);
+	
 	// Set linear filtering
 	bind();
 	setFiltering(WInt_Filter_Linear);
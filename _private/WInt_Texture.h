@@ -14,10 +14,16 @@
 // Upload from a WInt_Image
 // If an Image is supplied, is uploaded immediately
 // Can also call upload() manually to upload anew, e.g. after modifying
+// - GL is only touched on the thread that draws: upload() copies the image,
+//   which W uploads before drawing the next frame. Likewise, deleting the
+//   texture queues its GL name for deletion.
 
 #ifndef __W__WInt_Texture__
 #define __W__WInt_Texture__
 
+#include <set>
+#include <vector>
+
 
 class WInt_Image;
 
@@ -43,9 +49,15 @@ public:
 	
 	static void unbind();
 	
+	void _upload();	// Performs the queued upload: call on the GL thread
+	static std::set<WInt_Texture*> _pendingUploads;
+	
 private:
 	unsigned int glTexID;
 	
+	std::vector<unsigned char> pendingData;
+	int pendingChannels;
+	
 	void obtainOGLTexID();
 	
 };
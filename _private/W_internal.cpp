@@ -14,6 +14,9 @@
 #include "oglInclude.h"
 #include "TextureAtlas.h"
 #include "UpdateTimer.h"
+#include "RenderThread.h"
+#include "StorageObj.h"
+#include "WInt_Texture.h"
 #include "types.h"
 
 #ifdef WTARGET_MAC
@@ -32,9 +35,12 @@ namespace W {
 
 bool _firstUpdate = true;
 bool _popGS = false;
+bool _backToBack = false;		// Updates are run by the loop in _start(), not the UpdateTimer
+bool _quitBackToBack = false;
 
 void _update();
 void _updateAllViewPositions();
+void _getViewsToDraw(std::vector<W::View*> &);
 void _quit();
 
 W::OpenGLState::OpenGLState() :
@@ -56,13 +62,16 @@ void W::OpenGLState::setUpInitially() {
 	glEnable(GL_SCISSOR_TEST);
 
 	glEnable(GL_BLEND);
-	setBlendMode(BlendMode::Normal);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	curBlendMode = BlendMode::Normal;
 	
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glEnableClientState(GL_COLOR_ARRAY);
 }
 void W::OpenGLState::setBlendMode(BlendMode::T m) {
 	w_dout << " OpenGLState::setBlendMode() (mode " << m << ")\n";
+	if (m == curBlendMode) return;
+	curBlendMode = m;
 	if (m == BlendMode::Normal)
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	else if (m == BlendMode::Additive)
@@ -75,6 +84,18 @@ void W::OpenGLState::bindAtlas(TextureAtlas *a) {
 		curBoundTexAtlas = a;
 	}
 }
+void W::OpenGLState::deleteVBOs(std::vector<unsigned int> &vbos) {
+	#ifdef W_VBOS
+		if (!vbos.empty())
+			glDeleteBuffers((int) vbos.size(), &vbos[0]);
+	#endif
+	vbos.clear();
+}
+void W::OpenGLState::deleteTextures(std::vector<unsigned int> &texs) {
+	if (!texs.empty())
+		glDeleteTextures((int) texs.size(), &texs[0]);
+	texs.clear();
+}
 void W::OpenGLState::enableTexturing() {
 	w_dout << " OpenGLState::enableTexturing()";
 	if (!texturingEnabled) {
@@ -106,13 +127,24 @@ W::WObjs::WObjs() :
 	window(NULL),
 	updateTimer(NULL),
 	gameTimer(NULL),
-	returny(ReturnyType::Empty)
+	returny(ReturnyType::Empty),
+	frameRate(0),
+	fixedStepMicroseconds(0),
+	maxStepsPerUpdate(5),
+	accumulatedMicroseconds(0),
+	renderAlpha(1),
+	virtualTickMicroseconds(0),
+	skipDrawing(false),
+	pipelined(false),
+	renderThread(NULL),
+	viewportNeedsSetUp(true)
 {
 	// Hai WObjs
 }
 W::WObjs::~WObjs()
 {
-	updateTimer->stop();
+	if (updateTimer) updateTimer->stop();
+	delete renderThread;
 	delete updateTimer;
 	delete gameTimer;
 	if (window) delete window;
@@ -129,17 +161,32 @@ void W::_createWindow(W::v2i sz, std::string title) {
 	}
 	wObjs.window = new Window(sz, title);
 	wObjs.updateTimer = new UpdateTimer(_update);
+	if (wObjs.frameRate)
+		wObjs.updateTimer->setFrequency(wObjs.frameRate);
 	wObjs.gameTimer = new Timer();
 }
 
 
 void W::_start() {
-	if (!wObjs.window)
+	if (!wObjs.window && !wObjs.replayer.isOpen())
 		throw Exception("start() called, but no window has been created");
 	if (wObjs.gsStack.empty())
 		throw Exception("start() called, but no GameState has been pushed");
 	
+	// Draw on a render thread, which then owns the GL context
+	if (wObjs.pipelined && wObjs.window && wObjs.window->canDraw())
+		wObjs.renderThread = new RenderThread(wObjs.window);
+	
+	// Replaying without a window, or fast-forwarding: run updates back to back
+	if (!wObjs.window || wObjs.virtualTickMicroseconds) {
+		_backToBack = true;
+		while (!_quitBackToBack)
+			_update();
+		return;
+	}
+	
 	wObjs.updateTimer->start();
+		// Linux: runs the update loop, returning after _quit()
 	
 	// Win: enter message pump
 	#if defined WTARGET_WIN
@@ -160,6 +207,12 @@ void W::_start() {
 }
 
 
+void W::_waitForRenderThread() {
+	if (wObjs.renderThread)
+		wObjs.renderThread->waitIdle();
+}
+
+
 void W::_pushState(GameState *g) {
 //	if (!states.empty()) states.back()->pause();
 	wObjs.gsStack.push_back(g);
@@ -172,9 +225,11 @@ void W::_popState(const Returny &r) {
 
 void _doPopState() {
 	W::WObjs &objs = W::wObjs;
+	W::Jobs::_joinFrameJobs();	// Jobs may refer to the state
 	do {
 		_popGS = false;
 		W::GameState *last_gs = objs.gsStack.back();
+		W::_waitForRenderThread();	// The state may delete views being drawn
 		delete last_gs;
 		W::Messenger::_gamestateDestroyed(last_gs);
 		objs.gsStack.pop_back();
@@ -186,19 +241,79 @@ void _doPopState() {
 	} while (_popGS && objs.gsStack.size());
 }
 
-void _update() {
+// A simulation step: dispatch any pending events (in the first step of an
+// update only), then update the top gamestate
+void _simulationStep(bool first) {
 	W::WObjs &objs = W::wObjs;
 	
-	if (_firstUpdate) {
-		objs.window->setOpenGLThreadAffinity();
-		objs.window->setUpViewport();
-		_firstUpdate = false;
+	if (first) {
+		W_PROFILE_ZONE("Event dispatch");
+		objs.coalescer.process(objs.frameEvents);
+		
+		W::GameState *g = objs.gsStack.back();
+		W::v2i wSz = W::windowSize();
+		
+		for (auto ev : objs.frameEvents) {
+			if (ev.type == W::EventType::Closed) {
+				g->handleCloseEvent();
+			}
+			else {
+				// Correct any touch events that are misplaced due to calibration error
+				if (ev.pos.a < 0)           { ev.pos.a = 0; }
+				else if (ev.pos.a >= wSz.a) { ev.pos.a = wSz.a - 1; }
+				if (ev.pos.b < 0)           { ev.pos.b = 0; }
+				else if (ev.pos.b >= wSz.b) { ev.pos.b = wSz.b - 1; }
+				
+				W::Messenger::dispatchEvent(ev);
+			}
+		}
+		if (!objs.frameEvents.empty())
+			W::Messenger::dispatchBatches(&objs.frameEvents[0], (int) objs.frameEvents.size());
+		objs.frameEvents.clear();
+		
+		// Check for poppage due to event input
+		if (_popGS) {
+			_doPopState();
+			_popGS = false;
+			return;
+		}
 	}
 	
-	if (objs.window->winSizeHasChanged) {
-		objs.window->setUpViewport();
-		_updateAllViewPositions();
-		objs.window->winSizeHasChanged = false;
+	// Update if no poppage
+	if (objs.gsStack.size()) {
+		W_PROFILE_ZONE("GameState::update");
+		objs.gsStack.back()->update();
+		W::Jobs::_joinFrameJobs();
+		
+		// Check for poppage due to update
+		if (_popGS) {
+			_doPopState();
+			_popGS = false;
+		}
+	}
+}
+
+void _update() {
+	W_PROFILE_ZONE("W::_update");
+	W::WObjs &objs = W::wObjs;
+	
+	if (objs.window) {
+		// With a render thread, GL is set up there instead
+		bool canDraw = objs.window->canDraw() && !objs.renderThread;
+		if (_firstUpdate) {
+			if (canDraw) {
+				objs.window->setOpenGLThreadAffinity();
+				objs.window->setUpViewport();
+			}
+			_firstUpdate = false;
+		}
+		
+		if (objs.window->winSizeHasChanged) {
+			if (canDraw) objs.window->setUpViewport();
+			objs.viewportNeedsSetUp = true;
+			_updateAllViewPositions();
+			objs.window->winSizeHasChanged = false;
+		}
 	}
 	
 	if (objs.gsStack.empty()) {
@@ -206,77 +321,133 @@ void _update() {
 		return;
 	}
 	
-	W::updateMicroseconds = (int) objs.gameTimer->getMicroseconds();
-	objs.gameTimer->reset();
 	
+	/* 1. Input */
 	
-	/* 1. Event sending */
+	W::Messenger::_newFrame();
 	
-	#ifndef WTARGET_IOS
-		objs.window->generateMouseMoveEvent();
-	#endif
-		
-	#ifdef WTARGET_WIN
-		W::Event::_mutex.lock();
-	#endif
+	// Events may be held over from the last update, if it ran no simulation step
+	int nHeldOver = (int) objs.frameEvents.size();
+	int tickMicroseconds;
 	
-	W::GameState *g = objs.gsStack.back();
-
-	for (auto ev : W::Event::_events) {
-		if (ev.type == W::EventType::Closed) {
-			g->handleCloseEvent();
+	if (objs.replayer.isOpen()) {
+		// Take this frame's input from the recording
+		if (!objs.replayer.readFrame(tickMicroseconds, objs.frameEvents)) {
+			w_dout << "Replay finished after " << objs.replayer.nFrames << " frames\n";
+			objs.replayer.close();
+			_quit();
+			return;
 		}
+	}
+	else {
+		if (objs.virtualTickMicroseconds)
+			tickMicroseconds = objs.virtualTickMicroseconds;
 		else {
-			// Correct any touch events that are misplaced due to calibration error
-			W::v2i wSz = objs.window->getSize();
-			if (ev.pos.a < 0)           { ev.pos.a = 0; }
-			else if (ev.pos.a >= wSz.a) { ev.pos.a = wSz.a - 1; }
-			if (ev.pos.b < 0)           { ev.pos.b = 0; }
-			else if (ev.pos.b >= wSz.b) { ev.pos.b = wSz.b - 1; }
-
-			W::Messenger::dispatchEvent(ev);
+			tickMicroseconds = (int) objs.gameTimer->getMicroseconds();
+			objs.gameTimer->reset();
 		}
+		
+		#if !defined WTARGET_IOS && !defined WTARGET_LINUX
+			objs.window->generateMouseMoveEvent();
+		#endif
+		
+		// Take this frame's events from the queue - producers never wait on dispatch
+		W::Event::_drainEvents(objs.frameEvents);
 	}
-	W::Event::_events.clear();
 	
-	#ifdef WTARGET_WIN
-		W::Event::_mutex.unlock();
-	#endif
+	if (objs.recorder.isOpen())
+		objs.recorder.writeFrame(tickMicroseconds, objs.frameEvents, nHeldOver);
 	
-	// Check for poppage due to event input
-	if (_popGS) {
-		_doPopState();
-		_popGS = false;
+	
+	/* 2. Simulation */
+	
+	// With a fixed timestep, run as many whole steps as the elapsed time allows,
+	// carrying the remainder over. Otherwise, run one step of the elapsed time.
+	int nSteps = 1;
+	if (int step = objs.fixedStepMicroseconds) {
+		objs.accumulatedMicroseconds += tickMicroseconds;
+		nSteps = objs.accumulatedMicroseconds / step;
+		if (nSteps > objs.maxStepsPerUpdate) {
+			// Too far behind to catch up: drop the backlog, rather than spiral
+			nSteps = objs.maxStepsPerUpdate;
+			objs.accumulatedMicroseconds %= step;
+		}
+		else
+			objs.accumulatedMicroseconds -= nSteps * step;
+		
+		W::updateMicroseconds = step;
+		objs.renderAlpha = objs.accumulatedMicroseconds / (float) step;
+	}
+	else {
+		W::updateMicroseconds = tickMicroseconds;
+		objs.renderAlpha = 1;
 	}
 	
+	for (int i=0; i < nSteps && objs.gsStack.size(); ++i)
+		_simulationStep(i == 0);
 	
-	/* 2. Update (if no poppage) */
 	
-	// Update if no poppage
-	else if (objs.gsStack.size()) {
-		g = objs.gsStack.back();
-		g->update();
-		
-		// Check for poppage due to update
-		if (_popGS) {
-			_doPopState();
-			_popGS = false;
-		}
+	// Without a window (i.e. replaying headlessly) or renderer (Linux without
+	// OSMesa), there is nothing to draw to
+	if (!objs.window || !objs.window->canDraw())
+		return;
+	if (objs.virtualTickMicroseconds && objs.skipDrawing)
+		return;
+	
+	
+	/* 3. Pipelined: hand the frame over to the render thread */
+	
+	if (W::RenderThread *rt = objs.renderThread) {
+		W_PROFILE_ZONE("Drawing");
+		rt->waitIdle();
+		W::RenderThread::Frame &f = rt->frame;
+		_getViewsToDraw(f.views);
+		for (std::vector<W::View*>::iterator it = f.views.begin(); it < f.views.end(); ++it)
+			(*it)->_prepareDraw();
+		f.atlases.assign(W::TextureAtlas::modifiedAtlases.begin(), W::TextureAtlas::modifiedAtlases.end());
+		W::TextureAtlas::modifiedAtlases.clear();
+		f.textures.assign(WInt_Texture::_pendingUploads.begin(), WInt_Texture::_pendingUploads.end());
+		WInt_Texture::_pendingUploads.clear();
+		f.deletedVBOs.swap(W::StorageObj::_deletedVBOs);
+		f.deletedTextures.swap(W::oglState._deletedTextures);
+		f.winSize = objs.window->getSize();
+		f.setUpViewport = objs.viewportNeedsSetUp;
+		objs.viewportNeedsSetUp = false;
+		rt->kick();
+		return;
 	}
 	
 	
-	/* 3. TextureAtlas uploading */
+	/* 3. TextureAtlas & texture uploading */
 	
 	for (std::set<W::TextureAtlas*>::iterator it = W::TextureAtlas::modifiedAtlases.begin(); it != W::TextureAtlas::modifiedAtlases.end(); ++it)
 		(*it)->upload();
 	W::TextureAtlas::modifiedAtlases.clear();
+	for (std::set<WInt_Texture*>::iterator it = WInt_Texture::_pendingUploads.begin(); it != WInt_Texture::_pendingUploads.end(); ++it)
+		(*it)->_upload();
+	WInt_Texture::_pendingUploads.clear();
 	
 	
 	/* 4. Drawing */
 	
+	W::oglState.deleteVBOs(W::StorageObj::_deletedVBOs);
+	W::oglState.deleteTextures(W::oglState._deletedTextures);
+	
+	W_PROFILE_ZONE("Drawing");
 	const W::v2i &window_size = objs.window->getSize();
 	objs.window->beginDrawing();
 	
+	static std::vector<W::View*> views;
+	_getViewsToDraw(views);
+	for (std::vector<W::View*>::iterator it = views.begin(); it < views.end(); ++it)
+		(*it)->_draw(window_size);
+	
+	objs.window->flushBuffer();
+}
+
+void _getViewsToDraw(std::vector<W::View*> &views) {
+	W::WObjs &objs = W::wObjs;
+	views.clear();
 	if (int n = (int)objs.gsStack.size()) {
 		// Draw all GameStates back to the last that was translucent - 1
 		int first_to_draw = n - 1;
@@ -284,14 +455,10 @@ void _update() {
 			if (objs.gsStack[i]->isTranslucent())
 				first_to_draw = (i ? i-1 : 0);
 		for (int i = first_to_draw; i < n; ++i) {
-			// Call _draw on all views
-			W::GameState::Viewlist &views = objs.gsStack[i]->_vlist;
-			for (W::GameState::Viewlist::iterator it = views.begin(); it != views.end(); ++it) {
-				(*it)->_draw(window_size);
-			}
+			W::GameState::Viewlist &vlist = objs.gsStack[i]->_vlist;
+			views.insert(views.end(), vlist.begin(), vlist.end());
 		}
 	}
-	objs.window->flushBuffer();
 }
 
 void _updateAllViewPositions() {
@@ -304,6 +471,16 @@ void _updateAllViewPositions() {
 }
 
 void _quit() {
+	W::wObjs.recorder.close();
+	
+	// Let the render thread finish drawing, then release the GL context
+	delete W::wObjs.renderThread;
+	W::wObjs.renderThread = NULL;
+
+	if (_backToBack) {
+		_quitBackToBack = true;
+		return;
+	}
 	W::wObjs.updateTimer->stop();
 	
 	#ifdef WTARGET_MAC
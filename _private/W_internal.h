@@ -19,6 +19,8 @@
 
 #include "W.h"
 #include "UpdateTimer.h"
+#include "EventCoalescer.h"
+#include "InputRecording.h"
 
 namespace W {
 	
@@ -30,6 +32,10 @@ namespace W {
 		
 		void setBlendMode(BlendMode::T);
 		void bindAtlas(TextureAtlas *);
+		void deleteVBOs(std::vector<unsigned int> &);	// Deletes & clears
+		void deleteTextures(std::vector<unsigned int> &);	// ~
+		
+		std::vector<unsigned int> _deletedTextures;	// Atlases' & WInt_Textures', to delete on the GL thread
 
 		TextureAtlas *curBoundTexAtlas;
 		BlendMode::T curBlendMode;
@@ -41,6 +47,9 @@ namespace W {
 	void _start();
 	void _pushState(GameState *);
 	void _popState(const Returny &);
+	void _waitForRenderThread();	// Call before changing anything the render thread may be drawing
+	
+	class RenderThread;
 	
 	struct WObjs {
 		WObjs();
@@ -51,6 +60,25 @@ namespace W {
 		
 		std::vector<GameState*> gsStack;
 		Returny returny;
+		
+		std::vector<Event> frameEvents;	// Reused each update, to avoid allocating
+		EventCoalescer coalescer;
+		
+		InputRecorder recorder;
+		InputReplayer replayer;	// If open, input comes from here rather than the event queue
+		
+		int frameRate;					// Updates per second, if set by setFrameRate()
+		int fixedStepMicroseconds;		// If nonzero, the simulation runs in steps of this length
+		int maxStepsPerUpdate;
+		int accumulatedMicroseconds;	// Elapsed time not yet simulated
+		float renderAlpha;
+		
+		int virtualTickMicroseconds;	// If nonzero, each update advances time by this much
+		bool skipDrawing;
+		
+		bool pipelined;					// If set, draw on a render thread - see setPipelinedRendering()
+		RenderThread *renderThread;
+		bool viewportNeedsSetUp;		// By the render thread, when it next draws
 	};
 	extern WObjs wObjs;
 }
@@ -19,6 +19,10 @@
     #include <Foundation/Foundation.h>
 #elif defined WTARGET_WIN
     #include "Windows.h"
+#elif defined WTARGET_LINUX
+    #include <sys/stat.h>
+    #include <cerrno>
+    #include <string>
 #endif
 
 bool W::isValidDir(const std::string &path) {
@@ -33,6 +37,9 @@ bool W::isValidDir(const char *path) {
     #elif defined _WIN32 || _WIN64
         DWORD dw = GetFileAttributes(path);
         return (dw != INVALID_FILE_ATTRIBUTES && (dw & FILE_ATTRIBUTE_DIRECTORY));
+    #elif defined WTARGET_LINUX
+        struct stat st;
+        return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
     #endif
 }
 bool W::createDir(const std::string &path) {
@@ -46,6 +53,14 @@ bool W::createDir(const char *dir) {
                                                                error:nil];
     #elif defined _WIN32 || _WIN64
         return CreateDirectory(dir, NULL);
+    #elif defined WTARGET_LINUX
+        // Create intermediate directories too, as on Mac
+        std::string p(dir);
+        for (size_t i = 1; i <= p.size(); ++i)
+            if (i == p.size() || p[i] == '/')
+                if (mkdir(p.substr(0, i).c_str(), 0755) != 0 && errno != EEXIST)
+                    return false;
+        return isValidDir(dir);
     #endif
 }
 
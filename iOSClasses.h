@@ -37,7 +37,7 @@ typedef void (*vdfncb)(void);
 
 @interface W_UpdateTimer : NSObject
 -(id)initWithCallback:(vdfncb)fp;
--(void)start;
+-(void)startWithFrequency:(int)hz;	// 0: default (every screen refresh)
 -(void)stop;
 -(void)callback:(id)sender;
 @end
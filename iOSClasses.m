@@ -207,9 +207,9 @@ inline W::v2i prevTouchLocInView(UITouch *t, UIView *v) {
 	return self;
 }
 
--(void)start {
+-(void)startWithFrequency:(int)hz {
 	displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(callback:)];
-	displayLink.frameInterval = 1;
+	displayLink.frameInterval = (hz > 0 && hz < 60 ? (60 + hz/2) / hz : 1);	// Refreshes to skip: nearest we can get
 	[displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSDefaultRunLoopMode];
 }
 -(void)stop {
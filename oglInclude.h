@@ -9,6 +9,15 @@
 #elif defined WTARGET_WIN
 	#include <gl\gl.h>
 	#include <gl\glu.h>
+#elif defined WTARGET_LINUX
+	#define GL_GLEXT_PROTOTYPES
+	#include <GL/gl.h>
+#endif
+
+// Vertex buffer objects are used wherever GL 1.5 / ES 1.1 functions can be
+// called directly - everywhere but Windows, whose gl.h stops at 1.1
+#ifndef WTARGET_WIN
+	#define W_VBOS
 #endif
 
 #endif
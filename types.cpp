@@ -42,11 +42,6 @@ W::v2i W::v2i::operator/ (int x) const { return v2i(a/x, b/x); }
 void W::v2i::operator*= (int x) { a *= x; b *= x; }
 void W::v2i::operator/= (int x) { a /= x; b /= x; }
 
-W::v2i& W::v2i::operator= (const v2i &v) {
-	a = v.a, b = v.b;
-	return *this;
-}
-
 std::string W::v2i::str() const {
 	std::stringstream ss;
 	ss << a << "," << b;
@@ -76,11 +71,6 @@ W::v2f W::v2f::operator/ (float x) const { return v2f(a/x, b/x); }
 void W::v2f::operator*= (float x) { a *= x; b *= x; }
 void W::v2f::operator/= (float x) { a /= x; b /= x; }
 
-W::v2f& W::v2f::operator= (const v2f &v) {
-	a = v.a, b = v.b;
-	return *this;
-}
-
 float W::v2f::mod() {
     return sqrtf(a*a + b*b);
 }
@@ -30,6 +30,9 @@
 #elif defined _WIN32 || _WIN64
 	#define WTARGET_WIN
 
+#elif defined __linux__
+	#define WTARGET_LINUX	// Headless: see Window.h
+
 #endif
 
 namespace W {
@@ -61,8 +64,6 @@ namespace W {
 		void operator*= (int x);
 		void operator/= (int x);
 		
-		v2i& operator= (const v2i &);
-		
 		std::string str() const;
 	};
 	
@@ -85,8 +86,6 @@ namespace W {
 		void operator*= (float x);
 		void operator/= (float x);
 		
-		v2f& operator= (const v2f &);
-		
 		float dot(const v2f &v2) {
 			return a*v2.a + b*v2.b;
 		}